@@ -0,0 +1,76 @@
+#pragma once
+
+#include <raylib.h>
+
+namespace eclipse {
+
+// Sprites of the symbol atlas, in atlas order
+enum class Sprite {
+    Fill,  // Plain, for tinted highlights
+    Sun,
+    Moon,
+    Count
+};
+
+// Everything the UI needs from the platform: a window to draw into and the
+// input that reaches it. RaylibBackend is the real one; HeadlessBackend
+// replays scripted input and counts draw calls, with no display.
+// Geometry and colours use raylib's plain structs either way.
+class Backend {
+public:
+    virtual ~Backend() = default;
+
+    // Window
+    virtual bool open(int width, int height, const char* title) = 0;
+    virtual bool should_close() = 0;
+    virtual bool window_resized() = 0;
+    virtual int screen_width() = 0;
+    virtual int screen_height() = 0;
+
+    // A frame is drawn between begin_frame and end_frame; end_frame shows
+    // it and takes in new input. Passes that draw nothing call poll_input,
+    // after sleeping with wait if they like.
+    virtual void begin_frame() = 0;
+    virtual void end_frame() = 0;
+    virtual void poll_input() = 0;
+    virtual void wait(double seconds) = 0;
+
+    // Input as of the last poll; only the left mouse button is used
+    virtual Vector2 mouse_position() = 0;
+    virtual Vector2 mouse_delta() = 0;
+    virtual bool mouse_pressed() = 0;
+    virtual bool key_pressed(int key) = 0;
+    virtual bool key_down(int key) = 0;
+
+    // Drawing
+    virtual void clear(Color color) = 0;
+    virtual void draw_rectangle(Rectangle rect, Color color) = 0;
+    virtual void draw_rectangle_lines(Rectangle rect, float thickness, Color color) = 0;
+    virtual void draw_rectangle_rounded(Rectangle rect, float roundness, Color color) = 0;
+    virtual void draw_text(const char* text, int x, int y, int font_size, Color color) = 0;
+    virtual int measure_text(const char* text, int font_size) = 0;
+
+    // The static board layer, pixels square. Drawing between
+    // begin_board_layer and end_board_layer goes into it, shifted so that
+    // (x, y) lands on its top-left corner. Called outside a frame.
+    virtual void begin_board_layer(int pixels, int x, int y) = 0;
+    virtual void end_board_layer() = 0;
+    virtual void draw_board_layer(int x, int y) = 0;
+
+    // Cell-sized sprites drawn in one batch between begin_sprites and
+    // end_sprites; build_sprites makes them for a cell size
+    virtual void build_sprites(int cell_size) = 0;
+    virtual void begin_sprites(int max_sprites) = 0;
+    virtual void draw_sprite(Rectangle dest, Sprite sprite, Color tint) = 0;
+    virtual void end_sprites() = 0;
+
+    virtual void set_clipboard(const char* text) = 0;
+
+    // Shorthand for the integer form most of the UI uses
+    void draw_rectangle(int x, int y, int width, int height, Color color) {
+        draw_rectangle(Rectangle{static_cast<float>(x), static_cast<float>(y),
+                                 static_cast<float>(width), static_cast<float>(height)}, color);
+    }
+};
+
+} // namespace eclipse
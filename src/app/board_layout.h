@@ -0,0 +1,62 @@
+#pragma once
+
+#include "core/grid.h"
+#include <algorithm>
+#include <optional>
+
+namespace eclipse {
+
+// Where the board sits on screen: board_size x board_size square cells of
+// cell_size pixels, the top-left one at (x, y). Cell geometry is plain
+// integer arithmetic, and so is the reverse, from a pixel to the cell
+// under it.
+class BoardLayout {
+public:
+    // Below this, symbols stop being readable; fit() lets the board
+    // overflow instead
+    static constexpr int kMinCellSize = 12;
+
+    BoardLayout() = default;
+    BoardLayout(int board_size, int x, int y, int cell_size)
+        : board_size_(board_size), x_(x), y_(y), cell_size_(cell_size) {}
+
+    // The largest cells, up to max_cell_size, that fit the board into the
+    // area whose top-left corner is (x, y)
+    static BoardLayout fit(int board_size, int x, int y, int width, int height,
+                           int max_cell_size) {
+        int cell_size = std::min({width / board_size, height / board_size, max_cell_size});
+        return BoardLayout(board_size, x, y, std::max(cell_size, kMinCellSize));
+    }
+
+    int board_size() const { return board_size_; }
+    int x() const { return x_; }
+    int y() const { return y_; }
+    int cell_size() const { return cell_size_; }
+
+    // Width and height of the whole board
+    int pixels() const { return board_size_ * cell_size_; }
+
+    // Top-left corner of a cell
+    int cell_x(int col) const { return x_ + col * cell_size_; }
+    int cell_y(int row) const { return y_ + row * cell_size_; }
+
+    // The cell under a pixel, if any
+    std::optional<Position> cell_at(int px, int py) const {
+        int dx = px - x_;
+        int dy = py - y_;
+        if (dx < 0 || dy < 0) return std::nullopt;
+
+        int col = dx / cell_size_;
+        int row = dy / cell_size_;
+        if (row >= board_size_ || col >= board_size_) return std::nullopt;
+        return Position{row, col};
+    }
+
+private:
+    int board_size_ = 0;
+    int x_ = 0;
+    int y_ = 0;
+    int cell_size_ = 1;
+};
+
+} // namespace eclipse
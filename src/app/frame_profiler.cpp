@@ -0,0 +1,119 @@
+#include "frame_profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
+#include <new>
+
+namespace eclipse {
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+constexpr const char* kPhaseNames[] = {
+    "handle_input",
+    "is_solved",
+    "hints",
+    "draw_main_menu",
+    "draw_game",
+    "draw_board",
+    "bake_board_layer",
+    "draw_regions",
+    "draw_clues",
+    "draw_ui_panel",
+    "draw_stats_screen",
+    "draw_completed_screen",
+};
+static_assert(std::size(kPhaseNames) == FrameProfiler::kPhases);
+
+} // namespace
+
+const char* phase_name(FramePhase phase) {
+    return kPhaseNames[static_cast<int>(phase)];
+}
+
+void FrameProfiler::begin_frame() {
+    if constexpr (!kEnabled) return;
+
+    current_ = Sample{};
+    frame_start_ = Clock::now();
+    frame_allocations_ = allocations();
+}
+
+void FrameProfiler::end_frame() {
+    if constexpr (!kEnabled) return;
+
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - frame_start_;
+    current_.frame_ms = elapsed.count();
+    current_.allocations = allocations() - frame_allocations_;
+
+    samples_[next_] = current_;
+    next_ = (next_ + 1) % kFrames;
+    count_ = std::min(count_ + 1, kFrames);
+}
+
+double FrameProfiler::average_ms(FramePhase phase) const {
+    if (count_ == 0) return 0.0;
+    double sum = 0.0;
+    for (int i = 0; i < count_; ++i) sum += samples_[i].phase_ms[static_cast<int>(phase)];
+    return sum / count_;
+}
+
+double FrameProfiler::average_frame_ms() const {
+    if (count_ == 0) return 0.0;
+    double sum = 0.0;
+    for (int i = 0; i < count_; ++i) sum += samples_[i].frame_ms;
+    return sum / count_;
+}
+
+double FrameProfiler::max_frame_ms() const {
+    double most = 0.0;
+    for (int i = 0; i < count_; ++i) most = std::max(most, samples_[i].frame_ms);
+    return most;
+}
+
+double FrameProfiler::average_allocations() const {
+    if (count_ == 0) return 0.0;
+    double sum = 0.0;
+    for (int i = 0; i < count_; ++i) sum += static_cast<double>(samples_[i].allocations);
+    return sum / count_;
+}
+
+uint64_t FrameProfiler::allocations() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace eclipse
+
+#if ECLIPSE_FRAME_PROFILER
+
+// Count every heap allocation in the program; the profiler reads the
+// difference across a frame
+void* operator new(std::size_t size) {
+    eclipse::g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+#endif
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+// The profiler is built into debug builds only, unless asked for with
+// -DECLIPSE_FRAME_PROFILER=ON, e.g. for a diagnostic web build.
+// Left out, its timers compile to nothing.
+#ifndef ECLIPSE_FRAME_PROFILER
+#ifdef NDEBUG
+#define ECLIPSE_FRAME_PROFILER 0
+#else
+#define ECLIPSE_FRAME_PROFILER 1
+#endif
+#endif
+
+namespace eclipse {
+
+// Parts of a frame timed separately. Times are inclusive: a phase running
+// inside another counts towards both.
+enum class FramePhase {
+    Input,
+    SolvedCheck,
+    Hints,
+    DrawMenu,
+    DrawGame,
+    DrawBoard,
+    DrawBoardLayer,
+    DrawRegions,
+    DrawClues,
+    DrawPanel,
+    DrawStats,
+    DrawCompleted,
+    Count
+};
+
+const char* phase_name(FramePhase phase);
+
+// Per-phase times and allocation counts of the last kFrames drawn frames,
+// kept in ring buffers so recording costs a clock read and an add
+class FrameProfiler {
+public:
+    static constexpr bool kEnabled = ECLIPSE_FRAME_PROFILER;
+    static constexpr int kFrames = 120;
+    static constexpr int kPhases = static_cast<int>(FramePhase::Count);
+
+    // A pass of the main loop that ends without end_frame(), having drawn
+    // nothing, is dropped by the next begin_frame()
+    void begin_frame();
+    void end_frame();
+
+    void add(FramePhase phase, double ms) { current_.phase_ms[static_cast<int>(phase)] += ms; }
+
+    // Averages and maximum over the frames recorded
+    double average_ms(FramePhase phase) const;
+    double average_frame_ms() const;
+    double max_frame_ms() const;
+    double average_allocations() const;
+
+    int frames_recorded() const { return count_; }
+
+    // Heap allocations since startup, counted by the replaced operator new
+    static uint64_t allocations();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Sample {
+        std::array<double, kPhases> phase_ms{};
+        double frame_ms = 0.0;
+        uint64_t allocations = 0;
+    };
+
+    std::array<Sample, kFrames> samples_{};
+    int next_ = 0;
+    int count_ = 0;
+
+    Sample current_;
+    Clock::time_point frame_start_;
+    uint64_t frame_allocations_ = 0;
+
+    friend class ScopedPhase;
+};
+
+// Adds the time from construction to destruction to a phase
+class ScopedPhase {
+public:
+    ScopedPhase(FrameProfiler& profiler, FramePhase phase)
+        : profiler_(profiler), phase_(phase), start_(FrameProfiler::Clock::now()) {}
+    ~ScopedPhase() {
+        std::chrono::duration<double, std::milli> elapsed = FrameProfiler::Clock::now() - start_;
+        profiler_.add(phase_, elapsed.count());
+    }
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+private:
+    FrameProfiler& profiler_;
+    FramePhase phase_;
+    FrameProfiler::Clock::time_point start_;
+};
+
+#define ECLIPSE_PROFILE_CONCAT_(a, b) a##b
+#define ECLIPSE_PROFILE_NAME_(line) ECLIPSE_PROFILE_CONCAT_(profile_phase_, line)
+
+#if ECLIPSE_FRAME_PROFILER
+#define PROFILE_PHASE(profiler, phase) \
+    ::eclipse::ScopedPhase ECLIPSE_PROFILE_NAME_(__LINE__)((profiler), ::eclipse::FramePhase::phase)
+#else
+#define PROFILE_PHASE(profiler, phase) ((void)0)
+#endif
+
+} // namespace eclipse
@@ -1,15 +1,43 @@
 #include "game_state.h"
 #include "core/generator.h"
+#include <bit>
 #include <sstream>
 
 namespace eclipse {
 
+namespace {
+
+// Web builds have no threads; there the solve waits for solve_deferred()
+constexpr std::launch kSolveLaunch =
+#ifdef PLATFORM_WEB
+    std::launch::deferred;
+#else
+    std::launch::async;
+#endif
+
+} // namespace
+
 GameState::GameState(std::unique_ptr<Puzzle> puzzle)
-    : puzzle_(std::move(puzzle)) {
-    // Solve to get solution for hints
-    solution_ = std::make_unique<Puzzle>(*puzzle_);
-    Solver solver(*solution_);
-    solver.solve();
+    : puzzle_(std::move(puzzle)),
+      forced_(*puzzle_),
+      history_(puzzle_->grid()) {
+    // Solve a private deep copy off the UI thread, so the first frame
+    // doesn't wait for it
+    solution_ = std::async(kSolveLaunch, [board = puzzle_->clone()]() mutable {
+        Solver solver(board);
+        solver.solve();
+        return board.grid();
+    }).share();
+}
+
+bool GameState::solution_ready() const {
+    return solution_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void GameState::solve_deferred() {
+    if (solution_.wait_for(std::chrono::seconds(0)) == std::future_status::deferred) {
+        solution_.wait();
+    }
 }
 
 void GameState::set_cell(int row, int col, Cell value) {
@@ -19,7 +47,48 @@ void GameState::set_cell(int row, int col, Cell value) {
     Move move{{row, col}, old_value, value};
     record_move(move);
     
-    puzzle_->grid().set(row, col, value);
+    write_cell(row, col, value);
+}
+
+void GameState::write_cell(int row, int col, Cell value) {
+    if (mistakes_synced_) {
+        Cell expected = solution_.get().get(row, col);
+        Cell old_value = puzzle_->grid().get(row, col);
+        mistakes_ -= (old_value != Cell::Empty && old_value != expected);
+        mistakes_ += (value != Cell::Empty && value != expected);
+    }
+    
+    puzzle_->set(row, col, value);
+    forced_.update(*puzzle_, row, col);
+}
+
+std::optional<int> GameState::mistakes() const {
+    if (!mistakes_synced_) {
+        if (!solution_ready()) return std::nullopt;
+        
+        // First query since the solution arrived: count once, then keep
+        // the count up to date from write_cell
+        const Grid& solution = solution_.get();
+        mistakes_ = 0;
+        for (int r = 0; r < puzzle_->size(); ++r) {
+            uint32_t suns = puzzle_->grid().row_bits(r, Cell::Sun);
+            uint32_t moons = puzzle_->grid().row_bits(r, Cell::Moon);
+            mistakes_ += std::popcount(suns & ~solution.row_bits(r, Cell::Sun)) +
+                         std::popcount(moons & ~solution.row_bits(r, Cell::Moon));
+        }
+        mistakes_synced_ = true;
+    }
+    return mistakes_;
+}
+
+bool GameState::has_contradiction() const {
+    uint64_t revision = puzzle_->grid().revision();
+    if (revision != contradiction_revision_) {
+        Puzzle probe = *puzzle_;
+        contradiction_ = Solver(probe).propagate_to_contradiction();
+        contradiction_revision_ = revision;
+    }
+    return contradiction_;
 }
 
 Cell GameState::get_cell(int row, int col) const {
@@ -27,46 +96,36 @@ Cell GameState::get_cell(int row, int col) const {
 }
 
 void GameState::record_move(const Move& move) {
-    undo_stack_.push(move);
-    // Clear redo stack when new move is made
-    while (!redo_stack_.empty()) {
-        redo_stack_.pop();
-    }
+    // Recording at the cursor drops the undone moves
+    double now = get_elapsed_time();
+    history_.record(move, static_cast<uint32_t>((now - last_move_time_) * 1000.0));
+    last_move_time_ = now;
 }
 
 void GameState::undo() {
-    if (undo_stack_.empty()) return;
-    
-    Move move = undo_stack_.top();
-    undo_stack_.pop();
+    if (!history_.can_undo()) return;
     
-    puzzle_->grid().set(move.position.row, move.position.col, move.old_value);
-    redo_stack_.push(move);
+    Move move = history_.undo();
+    write_cell(move.position.row, move.position.col, move.old_value);
 }
 
 void GameState::redo() {
-    if (redo_stack_.empty()) return;
-    
-    Move move = redo_stack_.top();
-    redo_stack_.pop();
+    if (!history_.can_redo()) return;
     
-    puzzle_->grid().set(move.position.row, move.position.col, move.new_value);
-    undo_stack_.push(move);
+    Move move = history_.redo();
+    write_cell(move.position.row, move.position.col, move.new_value);
 }
 
 std::optional<Position> GameState::get_hint_position(HintLevel level) {
-    Solver solver(*puzzle_);
-    auto forced_moves = solver.get_forced_moves();
-    
-    if (!forced_moves.empty()) {
-        return forced_moves[0].position;
+    if (auto forced = forced_.first()) {
+        return forced;
     }
     
     if (level == HintLevel::Reveal) {
         // Find first empty cell and return it
-        auto empty_cells = puzzle_->grid().get_empty_cells();
+        auto empty_cells = puzzle_->grid().empty_cells();
         if (!empty_cells.empty()) {
-            return empty_cells[0];
+            return *empty_cells.begin();
         }
     }
     
@@ -81,30 +140,26 @@ void GameState::apply_hint(HintLevel level) {
         return;
     }
     
-    Solver solver(*puzzle_);
-    auto forced_moves = solver.get_forced_moves();
-    
-    if (!forced_moves.empty() && level == HintLevel::Apply) {
+    auto forced = forced_.first();
+    if (forced && level == HintLevel::Apply) {
         // Apply first forced move
-        const auto& step = forced_moves[0];
-        set_cell(step.position.row, step.position.col, step.value);
+        set_cell(forced->row, forced->col, forced_.value_at(forced->row, forced->col));
         return;
     }
     
     if (level == HintLevel::Reveal) {
         // Reveal a cell from solution
-        auto empty_cells = puzzle_->grid().get_empty_cells();
+        auto empty_cells = puzzle_->grid().empty_cells();
         if (!empty_cells.empty()) {
-            Position pos = empty_cells[0];
-            Cell solution_value = solution_->grid().get(pos.row, pos.col);
+            Position pos = *empty_cells.begin();
+            Cell solution_value = solution_.get().get(pos.row, pos.col);
             set_cell(pos.row, pos.col, solution_value);
         }
     }
 }
 
 bool GameState::is_solved() const {
-    if (!puzzle_->grid().is_complete()) return false;
-    return puzzle_->is_valid();
+    return puzzle_->is_solved();
 }
 
 bool GameState::is_valid() const {
@@ -2,20 +2,18 @@
 
 #include "core/constraints.h"
 #include "core/solver.h"
+#include "core/forced_moves.h"
+#include "core/move_log.h"
 #include "persistence.h"
 #include <vector>
-#include <stack>
 #include <memory>
 #include <chrono>
+#include <cstdint>
+#include <future>
+#include <optional>
 
 namespace eclipse {
 
-struct Move {
-    Position position;
-    Cell old_value;
-    Cell new_value;
-};
-
 enum class HintLevel {
     Highlight,  // Highlight a forced cell
     Apply,      // Apply a forced move
@@ -33,14 +31,42 @@ public:
     // Undo/Redo
     void undo();
     void redo();
-    bool can_undo() const { return !undo_stack_.empty(); }
-    bool can_redo() const { return !redo_stack_.empty(); }
+    bool can_undo() const { return history_.can_undo(); }
+    bool can_redo() const { return history_.can_redo(); }
+    
+    // Every move of the game with its timing, undone moves included
+    const MoveLog& history() const { return history_; }
     
     // Hints
     std::optional<Position> get_hint_position(HintLevel level);
     void apply_hint(HintLevel level);
     int hints_used() const { return hints_used_; }
     
+    // The solution behind Reveal hints is worked out in the background from
+    // construction. True once it can be read without waiting; a Reveal
+    // before then blocks until it is done.
+    bool solution_ready() const;
+    
+    // Web builds have no background thread, so there the solve waits until
+    // this is called and then runs in full. Call it where the UI is idle;
+    // elsewhere it does nothing.
+    void solve_deferred();
+    
+    // Filled cells that differ from the solution, or nullopt while the
+    // solution isn't ready. Zero means the board can still reach it.
+    // Kept as a running count, so O(1) per move.
+    std::optional<int> mistakes() const;
+    
+    // Whether propagation from the current board runs into a broken rule or
+    // a cell with no legal value. Works without the solution; worked out
+    // once per board change.
+    bool has_contradiction() const;
+    
+    // Cells that can be deduced from the current board, kept up to date by
+    // every move, so cheap enough to query each frame
+    int deducible_count() const { return forced_.count(); }
+    const ForcedMoves& forced_moves() const { return forced_; }
+    
     // Check if puzzle is solved
     bool is_solved() const;
     bool is_valid() const;
@@ -59,10 +85,19 @@ public:
     
 private:
     std::unique_ptr<Puzzle> puzzle_;
-    std::unique_ptr<Puzzle> solution_;  // Store solution for hints
+    std::shared_future<Grid> solution_;  // Solution for Reveal hints
+    ForcedMoves forced_;                 // Forced cells of *puzzle_
+    
+    // Running count for mistakes(), valid while mistakes_synced_ is set
+    mutable int mistakes_ = 0;
+    mutable bool mistakes_synced_ = false;
     
-    std::stack<Move> undo_stack_;
-    std::stack<Move> redo_stack_;
+    // has_contradiction() result for the grid at contradiction_revision_
+    mutable bool contradiction_ = false;
+    mutable uint64_t contradiction_revision_ = UINT64_MAX;
+    
+    MoveLog history_;
+    double last_move_time_ = 0.0;  // get_elapsed_time() at the last move
     
     int hints_used_ = 0;
     
@@ -71,6 +106,9 @@ private:
     bool timer_running_ = false;
     
     void record_move(const Move& move);
+    
+    // Write a cell and bring the forced-move set up to date
+    void write_cell(int row, int col, Cell value);
 };
 
 } // namespace eclipse
@@ -0,0 +1,169 @@
+#include "headless_backend.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace eclipse {
+
+namespace {
+
+struct KeyName {
+    const char* name;
+    int code;
+};
+
+// The keys the UI reads
+constexpr KeyName kKeys[] = {
+    {"Z", KEY_Z},
+    {"Y", KEY_Y},
+    {"H", KEY_H},
+    {"F3", KEY_F3},
+    {"LEFT_CONTROL", KEY_LEFT_CONTROL},
+    {"LEFT_SUPER", KEY_LEFT_SUPER},
+};
+
+int parse_key(const std::string& name) {
+    for (const KeyName& key : kKeys) {
+        if (name == key.name) return key.code;
+    }
+    try {
+        size_t used = 0;
+        int code = std::stoi(name, &used);
+        if (used == name.size()) return code;
+    } catch (const std::exception&) {
+    }
+    throw std::invalid_argument("Unknown key in input script: " + name);
+}
+
+} // namespace
+
+std::vector<ScriptedInput> HeadlessBackend::parse_script(std::istream& in) {
+    std::vector<ScriptedInput> script;
+    std::string line;
+    int line_number = 0;
+
+    while (std::getline(in, line)) {
+        ++line_number;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream fields(line);
+        ScriptedInput event;
+        std::string kind;
+        if (!(fields >> event.frame)) {
+            if (fields.eof()) continue;  // Blank
+            throw std::invalid_argument("Bad frame number on script line " + std::to_string(line_number));
+        }
+        fields >> kind;
+
+        bool ok = true;
+        if (kind == "move" || kind == "click" || kind == "resize") {
+            event.kind = kind == "move" ? ScriptedInput::Kind::Move
+                       : kind == "click" ? ScriptedInput::Kind::Click
+                       : ScriptedInput::Kind::Resize;
+            ok = static_cast<bool>(fields >> event.a >> event.b);
+        } else if (kind == "key" || kind == "hold" || kind == "release") {
+            event.kind = kind == "key" ? ScriptedInput::Kind::Key
+                       : kind == "hold" ? ScriptedInput::Kind::Hold
+                       : ScriptedInput::Kind::Release;
+            std::string name;
+            ok = static_cast<bool>(fields >> name);
+            if (ok) event.a = parse_key(name);
+        } else {
+            ok = false;
+        }
+
+        std::string rest;
+        if (!ok || event.frame < 0 || (fields >> rest)) {
+            throw std::invalid_argument("Bad input script line " + std::to_string(line_number));
+        }
+        script.push_back(event);
+    }
+    return script;
+}
+
+HeadlessBackend::HeadlessBackend(std::vector<ScriptedInput> script, int frames)
+    : script_(std::move(script)) {
+    std::stable_sort(script_.begin(), script_.end(),
+                     [](const ScriptedInput& a, const ScriptedInput& b) { return a.frame < b.frame; });
+    frames_ = std::max(frames, script_.empty() ? 0 : script_.back().frame + 1);
+}
+
+bool HeadlessBackend::open(int width, int height, const char*) {
+    width_ = width;
+    height_ = height;
+    apply_events();
+    return true;
+}
+
+void HeadlessBackend::begin_frame() {
+    drew_ = true;
+    draw_calls_ = 0;
+}
+
+void HeadlessBackend::end_frame() {
+    advance();
+}
+
+void HeadlessBackend::poll_input() {
+    drew_ = false;
+    draw_calls_ = 0;
+    advance();
+}
+
+bool HeadlessBackend::key_pressed(int key) {
+    return std::find(pressed_.begin(), pressed_.end(), key) != pressed_.end();
+}
+
+bool HeadlessBackend::key_down(int key) {
+    return key_pressed(key) || std::find(held_.begin(), held_.end(), key) != held_.end();
+}
+
+int HeadlessBackend::measure_text(const char* text, int font_size) {
+    // Near enough to raylib's default font for laying out
+    return static_cast<int>(std::strlen(text)) * font_size * 3 / 5;
+}
+
+void HeadlessBackend::advance() {
+    ++frame_;
+    apply_events();
+}
+
+void HeadlessBackend::apply_events() {
+    resized_ = false;
+    mouse_delta_ = {0, 0};
+    mouse_pressed_ = false;
+    pressed_.clear();
+
+    for (; next_event_ < script_.size() && script_[next_event_].frame <= frame_; ++next_event_) {
+        const ScriptedInput& event = script_[next_event_];
+        switch (event.kind) {
+            case ScriptedInput::Kind::Click:
+                mouse_pressed_ = true;
+                [[fallthrough]];
+            case ScriptedInput::Kind::Move: {
+                Vector2 to = {static_cast<float>(event.a), static_cast<float>(event.b)};
+                mouse_delta_ = {to.x - mouse_.x, to.y - mouse_.y};
+                mouse_ = to;
+                break;
+            }
+            case ScriptedInput::Kind::Key:
+                pressed_.push_back(event.a);
+                break;
+            case ScriptedInput::Kind::Hold:
+                held_.push_back(event.a);
+                break;
+            case ScriptedInput::Kind::Release:
+                held_.erase(std::remove(held_.begin(), held_.end(), event.a), held_.end());
+                break;
+            case ScriptedInput::Kind::Resize:
+                width_ = event.a;
+                height_ = event.b;
+                resized_ = true;
+                break;
+        }
+    }
+}
+
+} // namespace eclipse
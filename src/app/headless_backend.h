@@ -0,0 +1,112 @@
+#pragma once
+
+#include "backend.h"
+#include <istream>
+#include <vector>
+
+namespace eclipse {
+
+// One scripted input event, applied at the start of pass `frame` of the
+// main loop
+struct ScriptedInput {
+    enum class Kind {
+        Move,     // Mouse to (a, b)
+        Click,    // Mouse to (a, b) and a left click there
+        Key,      // Key a pressed this pass
+        Hold,     // Key a held down from this pass on
+        Release,  // Key a let go
+        Resize    // Window resized to a x b
+    };
+
+    int frame = 0;
+    Kind kind = Kind::Move;
+    int a = 0;
+    int b = 0;
+};
+
+// A backend without a display: input comes from a script, one main-loop
+// pass at a time, and drawing only counts the calls made. Runs the UI's
+// frame logic anywhere, e.g. to time it in CI.
+class HeadlessBackend : public Backend {
+public:
+    // Read a script, one event per line:
+    //   <frame> move <x> <y>      <frame> click <x> <y>
+    //   <frame> key <name>        <frame> hold <name>
+    //   <frame> release <name>    <frame> resize <width> <height>
+    // Key names are raylib's without KEY_ (Z, H, F3, LEFT_CONTROL...) or
+    // key codes. Blank lines and text after '#' are ignored.
+    // Throws std::invalid_argument on a line it can't read.
+    static std::vector<ScriptedInput> parse_script(std::istream& in);
+
+    // Runs for frames passes, or until just after the last event if later
+    HeadlessBackend(std::vector<ScriptedInput> script, int frames = 0);
+
+    // Passes of the main loop so far
+    int frame() const { return frame_; }
+
+    // Whether the last pass drew, and the draw calls it made
+    bool drew() const { return drew_; }
+    int draw_calls() const { return draw_calls_; }
+
+    bool open(int width, int height, const char* title) override;
+    bool should_close() override { return frame_ >= frames_; }
+    bool window_resized() override { return resized_; }
+    int screen_width() override { return width_; }
+    int screen_height() override { return height_; }
+
+    void begin_frame() override;
+    void end_frame() override;
+    void poll_input() override;
+    void wait(double) override {}
+
+    Vector2 mouse_position() override { return mouse_; }
+    Vector2 mouse_delta() override { return mouse_delta_; }
+    bool mouse_pressed() override { return mouse_pressed_; }
+    bool key_pressed(int key) override;
+    bool key_down(int key) override;
+
+    void clear(Color) override { ++draw_calls_; }
+    void draw_rectangle(Rectangle, Color) override { ++draw_calls_; }
+    void draw_rectangle_lines(Rectangle, float, Color) override { ++draw_calls_; }
+    void draw_rectangle_rounded(Rectangle, float, Color) override { ++draw_calls_; }
+    void draw_text(const char*, int, int, int, Color) override { ++draw_calls_; }
+    int measure_text(const char* text, int font_size) override;
+
+    void begin_board_layer(int, int, int) override {}
+    void end_board_layer() override {}
+    void draw_board_layer(int, int) override { ++draw_calls_; }
+
+    void build_sprites(int) override {}
+    void begin_sprites(int) override {}
+    void draw_sprite(Rectangle, Sprite, Color) override { ++draw_calls_; }
+    void end_sprites() override {}
+
+    void set_clipboard(const char*) override {}
+
+    using Backend::draw_rectangle;
+
+private:
+    std::vector<ScriptedInput> script_;  // Sorted by frame
+    size_t next_event_ = 0;
+    int frames_ = 0;
+    int frame_ = 0;
+
+    int width_ = 0;
+    int height_ = 0;
+    bool resized_ = false;
+
+    Vector2 mouse_{0, 0};
+    Vector2 mouse_delta_{0, 0};
+    bool mouse_pressed_ = false;
+    std::vector<int> pressed_;
+    std::vector<int> held_;
+
+    bool drew_ = false;
+    int draw_calls_ = 0;
+
+    // Move on to the next pass and apply its events
+    void advance();
+    void apply_events();
+};
+
+} // namespace eclipse
@@ -0,0 +1,133 @@
+// Runs the game's frame loop without a display, driven by an input script,
+// and reports the time each pass took:
+//
+//   eclipse_headless [--date YYYY-MM-DD] [--data-dir DIR] <script> [frames]
+//
+// Prints one CSV line per pass (frame, ms, drew, draw_calls), a summary of
+// the passes that drew and the board the script left behind. --date pins
+// the daily puzzle, so the same script always plays the same board.
+// Stats go to DIR, or to a fresh directory removed after the run.
+#include "ui.h"
+#include "headless_backend.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool is_date(const std::string& text) {
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-') return false;
+    for (size_t i : {0, 1, 2, 3, 5, 6, 8, 9}) {
+        if (text[i] < '0' || text[i] > '9') return false;
+    }
+    return true;
+}
+
+// One line per board, rows separated by '/': '.' empty, 'S' Sun, 'M' Moon
+std::string board_text(const eclipse::Grid& grid) {
+    std::string text;
+    for (int r = 0; r < grid.size(); ++r) {
+        if (r > 0) text += '/';
+        for (int c = 0; c < grid.size(); ++c) {
+            eclipse::Cell value = grid.get(r, c);
+            text += value == eclipse::Cell::Sun ? 'S' : value == eclipse::Cell::Moon ? 'M' : '.';
+        }
+    }
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string date;
+    std::string data_dir;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "--date" || arg == "--data-dir") && i + 1 < argc) {
+            (arg == "--date" ? date : data_dir) = argv[++i];
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty() || args.size() > 2 || (!date.empty() && !is_date(date))) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--date YYYY-MM-DD] [--data-dir DIR] <script> [frames]" << std::endl;
+        return 2;
+    }
+
+    // Keep the run's stats away from the player's, and from earlier runs
+    bool own_data_dir = data_dir.empty();
+    if (own_data_dir) {
+        std::random_device random;
+        data_dir = (std::filesystem::temp_directory_path() /
+                    ("eclipse-headless-" + std::to_string(random()))).string();
+    }
+
+    int status = 0;
+    try {
+        std::ifstream in(args[0]);
+        if (!in) {
+            std::cerr << "Cannot open " << args[0] << std::endl;
+            return 1;
+        }
+        int frames = args.size() > 1 ? std::stoi(args[1]) : 0;
+
+        auto backend = std::make_unique<eclipse::HeadlessBackend>(
+            eclipse::HeadlessBackend::parse_script(in), frames);
+        eclipse::HeadlessBackend& headless = *backend;
+
+        eclipse::UI ui(std::move(backend), data_dir);
+        if (!ui.init()) {
+            std::cerr << "Failed to initialize UI" << std::endl;
+            status = 1;
+        } else {
+            if (!date.empty()) ui.set_date(date);
+
+            std::vector<double> drawn_ms;
+            std::cout << "frame,ms,drew,draw_calls\n";
+            while (!headless.should_close()) {
+                int frame = headless.frame();
+                auto start = std::chrono::steady_clock::now();
+                ui.frame();
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+                std::printf("%d,%.4f,%d,%d\n", frame, elapsed.count(), headless.drew() ? 1 : 0,
+                            headless.drew() ? headless.draw_calls() : 0);
+                if (headless.drew()) drawn_ms.push_back(elapsed.count());
+            }
+
+            if (!drawn_ms.empty()) {
+                std::sort(drawn_ms.begin(), drawn_ms.end());
+                double sum = 0.0;
+                for (double ms : drawn_ms) sum += ms;
+                std::printf("# %zu frames drawn: mean %.4f ms, median %.4f ms, p95 %.4f ms, max %.4f ms\n",
+                            drawn_ms.size(), sum / drawn_ms.size(), drawn_ms[drawn_ms.size() / 2],
+                            drawn_ms[drawn_ms.size() * 95 / 100], drawn_ms.back());
+            }
+
+            if (const eclipse::GameState* game = ui.game_state()) {
+                std::printf("# board %s\n", board_text(game->puzzle().grid()).c_str());
+            } else {
+                std::printf("# board none\n");
+            }
+        }
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        status = 1;
+    }
+
+    if (own_data_dir) {
+        std::error_code ignored;
+        std::filesystem::remove_all(data_dir, ignored);
+    }
+    return status;
+}
@@ -1,9 +1,10 @@
 #include "ui.h"
+#include "raylib_backend.h"
 #include <iostream>
 
 int main() {
     try {
-        eclipse::UI ui;
+        eclipse::UI ui(std::make_unique<eclipse::RaylibBackend>());
         
         if (!ui.init()) {
             std::cerr << "Failed to initialize UI" << std::endl;
@@ -0,0 +1,186 @@
+#include "raylib_backend.h"
+#include <rlgl.h>
+
+namespace eclipse {
+
+RaylibBackend::~RaylibBackend() {
+    if (!open_) return;
+    if (board_layer_.id != 0) UnloadRenderTexture(board_layer_);
+    if (sprite_atlas_.id != 0) UnloadTexture(sprite_atlas_);
+    CloseWindow();
+}
+
+bool RaylibBackend::open(int width, int height, const char* title) {
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+    InitWindow(width, height, title);
+    SetTargetFPS(60);
+    open_ = IsWindowReady();
+    return open_;
+}
+
+bool RaylibBackend::should_close() {
+    return WindowShouldClose();
+}
+
+bool RaylibBackend::window_resized() {
+    return IsWindowResized();
+}
+
+int RaylibBackend::screen_width() {
+    return GetScreenWidth();
+}
+
+int RaylibBackend::screen_height() {
+    return GetScreenHeight();
+}
+
+void RaylibBackend::begin_frame() {
+    BeginDrawing();
+}
+
+void RaylibBackend::end_frame() {
+    EndDrawing();
+}
+
+void RaylibBackend::poll_input() {
+    PollInputEvents();
+}
+
+void RaylibBackend::wait(double seconds) {
+    // Blocking the browser's thread would stall the page; the web loop
+    // slows down through its timing instead
+#ifndef PLATFORM_WEB
+    WaitTime(seconds);
+#else
+    (void)seconds;
+#endif
+}
+
+Vector2 RaylibBackend::mouse_position() {
+    return GetMousePosition();
+}
+
+Vector2 RaylibBackend::mouse_delta() {
+    return GetMouseDelta();
+}
+
+bool RaylibBackend::mouse_pressed() {
+    return IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
+}
+
+bool RaylibBackend::key_pressed(int key) {
+    return IsKeyPressed(key);
+}
+
+bool RaylibBackend::key_down(int key) {
+    return IsKeyDown(key);
+}
+
+void RaylibBackend::clear(Color color) {
+    ClearBackground(color);
+}
+
+void RaylibBackend::draw_rectangle(Rectangle rect, Color color) {
+    DrawRectangleRec(rect, color);
+}
+
+void RaylibBackend::draw_rectangle_lines(Rectangle rect, float thickness, Color color) {
+    DrawRectangleLinesEx(rect, thickness, color);
+}
+
+void RaylibBackend::draw_rectangle_rounded(Rectangle rect, float roundness, Color color) {
+    DrawRectangleRounded(rect, roundness, 8, color);
+}
+
+void RaylibBackend::draw_text(const char* text, int x, int y, int font_size, Color color) {
+    DrawText(text, x, y, font_size, color);
+}
+
+int RaylibBackend::measure_text(const char* text, int font_size) {
+    return MeasureText(text, font_size);
+}
+
+void RaylibBackend::begin_board_layer(int pixels, int x, int y) {
+    if (board_layer_.id == 0 || board_layer_.texture.width != pixels) {
+        if (board_layer_.id != 0) UnloadRenderTexture(board_layer_);
+        board_layer_ = LoadRenderTexture(pixels, pixels);
+    }
+
+    // Shift the screen-space drawing code onto the texture's origin
+    Camera2D camera = {};
+    camera.offset = {-static_cast<float>(x), -static_cast<float>(y)};
+    camera.zoom = 1.0f;
+
+    BeginTextureMode(board_layer_);
+    BeginMode2D(camera);
+}
+
+void RaylibBackend::end_board_layer() {
+    EndMode2D();
+    EndTextureMode();
+}
+
+void RaylibBackend::draw_board_layer(int x, int y) {
+    // Render textures are stored upside down
+    float pixels = static_cast<float>(board_layer_.texture.width);
+    Rectangle source = {0, 0, pixels, -pixels};
+    DrawTextureRec(board_layer_.texture, source, {static_cast<float>(x), static_cast<float>(y)}, WHITE);
+}
+
+void RaylibBackend::build_sprites(int cell_size) {
+    if (sprite_atlas_.id != 0) {
+        if (sprite_atlas_.height == cell_size) return;
+        UnloadTexture(sprite_atlas_);
+    }
+
+    // One cell-sized sprite per Sprite value: a plain fill for highlights
+    // to tint, then the symbols as they were drawn as text
+    int count = static_cast<int>(Sprite::Count);
+    Image atlas = GenImageColor(cell_size * count, cell_size, BLANK);
+    ImageDrawRectangle(&atlas, 0, 0, cell_size, cell_size, WHITE);
+
+    int font_size = cell_size * 2 / 3;
+    int text_x = cell_size/2 - font_size * 3/8;
+    int text_y = cell_size/2 - font_size/2;
+    ImageDrawText(&atlas, "S", cell_size * static_cast<int>(Sprite::Sun) + text_x, text_y, font_size,
+                  Color{255, 200, 0, 255});
+    ImageDrawText(&atlas, "M", cell_size * static_cast<int>(Sprite::Moon) + text_x, text_y, font_size,
+                  Color{100, 100, 200, 255});
+
+    sprite_atlas_ = LoadTextureFromImage(atlas);
+    UnloadImage(atlas);
+}
+
+void RaylibBackend::begin_sprites(int max_sprites) {
+    // Every sprite goes out as a quad on the atlas in one batch, so the
+    // cost per sprite is four vertices
+    rlCheckRenderBatchLimit(4 * max_sprites);
+    rlSetTexture(sprite_atlas_.id);
+    rlBegin(RL_QUADS);
+}
+
+void RaylibBackend::draw_sprite(Rectangle dest, Sprite sprite, Color tint) {
+    float left = static_cast<float>(sprite) / static_cast<float>(Sprite::Count);
+    float right = static_cast<float>(static_cast<int>(sprite) + 1) / static_cast<float>(Sprite::Count);
+
+    rlColor4ub(tint.r, tint.g, tint.b, tint.a);
+    rlTexCoord2f(left, 0.0f);
+    rlVertex2f(dest.x, dest.y);
+    rlTexCoord2f(left, 1.0f);
+    rlVertex2f(dest.x, dest.y + dest.height);
+    rlTexCoord2f(right, 1.0f);
+    rlVertex2f(dest.x + dest.width, dest.y + dest.height);
+    rlTexCoord2f(right, 0.0f);
+    rlVertex2f(dest.x + dest.width, dest.y);
+}
+
+void RaylibBackend::end_sprites() {
+    rlEnd();
+    rlSetTexture(0);
+}
+
+void RaylibBackend::set_clipboard(const char* text) {
+    SetClipboardText(text);
+}
+
+} // namespace eclipse
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "backend.h"
+
+namespace eclipse {
+
+// The game's window, drawn and read through raylib
+class RaylibBackend : public Backend {
+public:
+    RaylibBackend() = default;
+    ~RaylibBackend() override;
+
+    RaylibBackend(const RaylibBackend&) = delete;
+    RaylibBackend& operator=(const RaylibBackend&) = delete;
+
+    bool open(int width, int height, const char* title) override;
+    bool should_close() override;
+    bool window_resized() override;
+    int screen_width() override;
+    int screen_height() override;
+
+    void begin_frame() override;
+    void end_frame() override;
+    void poll_input() override;
+    void wait(double seconds) override;
+
+    Vector2 mouse_position() override;
+    Vector2 mouse_delta() override;
+    bool mouse_pressed() override;
+    bool key_pressed(int key) override;
+    bool key_down(int key) override;
+
+    void clear(Color color) override;
+    void draw_rectangle(Rectangle rect, Color color) override;
+    void draw_rectangle_lines(Rectangle rect, float thickness, Color color) override;
+    void draw_rectangle_rounded(Rectangle rect, float roundness, Color color) override;
+    void draw_text(const char* text, int x, int y, int font_size, Color color) override;
+    int measure_text(const char* text, int font_size) override;
+
+    void begin_board_layer(int pixels, int x, int y) override;
+    void end_board_layer() override;
+    void draw_board_layer(int x, int y) override;
+
+    void build_sprites(int cell_size) override;
+    void begin_sprites(int max_sprites) override;
+    void draw_sprite(Rectangle dest, Sprite sprite, Color tint) override;
+    void end_sprites() override;
+
+    void set_clipboard(const char* text) override;
+
+    using Backend::draw_rectangle;
+
+private:
+    bool open_ = false;
+
+    // The board layer, drawn to through a camera that shifts it into place
+    RenderTexture2D board_layer_{};
+
+    // Sprites side by side, one cell wide each
+    Texture2D sprite_atlas_{};
+};
+
+} // namespace eclipse
@@ -1,7 +1,8 @@
 #include "ui.h"
 #include "core/daily_seed.h"
 #include "core/generator.h"
-#include <raylib.h>
+#include <algorithm>
+#include <bit>
 #include <cmath>
 #include <filesystem>
 
@@ -11,26 +12,38 @@
 
 namespace eclipse {
 
-UI::UI() {
-    // Get user data directory
-#ifdef _WIN32
-    std::string data_dir = std::string(getenv("APPDATA")) + "/ECLIPSE";
-#else
-    std::string data_dir = std::string(getenv("HOME")) + "/.eclipse";
-#endif
+namespace {
+
+const Color kBackground{245, 245, 245, 255};
+
+// Time between passes of the main loop while nothing needs drawing
+constexpr double kIdleFrameSeconds = 1.0 / 20.0;
+
+} // namespace
+
+UI::UI(std::unique_ptr<Backend> backend, const std::string& data_dir)
+    : backend_(std::move(backend)) {
     std::filesystem::create_directories(data_dir);
     
     persistence_ = std::make_unique<Persistence>(data_dir + "/eclipse.db");
     persistence_->load_stats(stats_);
 }
 
-UI::~UI() {
-    CloseWindow();
+UI::~UI() = default;
+
+std::string UI::default_data_dir() {
+    // Get user data directory
+#ifdef _WIN32
+    return std::string(getenv("APPDATA")) + "/ECLIPSE";
+#else
+    return std::string(getenv("HOME")) + "/.eclipse";
+#endif
 }
 
 bool UI::init() {
-    InitWindow(screen_width_, screen_height_, "ECLIPSE - Daily Puzzle");
-    SetTargetFPS(60);
+    if (!backend_->open(screen_width_, screen_height_, "ECLIPSE - Daily Puzzle")) {
+        return false;
+    }
     
     current_date_ = DailySeed::get_today_date();
     
@@ -41,22 +54,81 @@ void UI::run() {
 #ifdef PLATFORM_WEB
     emscripten_set_main_loop_arg([](void* arg) {
         UI* ui = static_cast<UI*>(arg);
-        if (!WindowShouldClose()) {
-            ui->handle_input();
-            ui->draw();
+        if (!ui->backend_->should_close()) {
+            ui->frame();
         }
     }, this, 0, 1);
 #else
-    while (!WindowShouldClose()) {
-        handle_input();
+    while (!backend_->should_close()) {
+        frame();
+    }
+#endif
+}
+
+void UI::frame() {
+    profiler_.begin_frame();
+    if (backend_->window_resized()) update_layout();
+    
+    handle_input();
+    
+    if (needs_redraw()) {
+        set_idle(false);
         draw();
+        return;
+    }
+    
+    // Nothing to draw: take in input without presenting a frame, and use
+    // the pause for a solve that couldn't run in the background
+    set_idle(true);
+    if (game_state_) game_state_->solve_deferred();
+    backend_->wait(kIdleFrameSeconds);
+    backend_->poll_input();
+}
+
+bool UI::needs_redraw() const {
+    if (frame_dirty_ || backend_->window_resized()) return true;
+    
+    // Buttons react to hovering and take their clicks while drawing
+    Vector2 mouse_delta = backend_->mouse_delta();
+    if (mouse_delta.x != 0 || mouse_delta.y != 0) return true;
+    if (backend_->mouse_pressed()) return true;
+    
+    if (game_state_ && (state_ == UIState::Playing || state_ == UIState::Paused)) {
+        if (static_cast<int>(game_state_->get_elapsed_time()) != drawn_second_) return true;
+        if (game_state_->solution_ready() != drawn_solution_ready_) return true;
+    }
+    return false;
+}
+
+void UI::set_idle(bool idle) {
+    if (idle == idle_) return;
+    idle_ = idle;
+    
+#ifdef PLATFORM_WEB
+    // The browser drives the loop: drop from animation frames to a slow
+    // timeout while idle
+    if (idle) {
+        emscripten_set_main_loop_timing(EM_TIMING_SETTIMEOUT, static_cast<int>(kIdleFrameSeconds * 1000));
+    } else {
+        emscripten_set_main_loop_timing(EM_TIMING_RAF, 1);
     }
 #endif
 }
 
 void UI::draw() {
-    BeginDrawing();
-    ClearBackground(Color{245, 245, 245, 255});
+    // Render-texture passes can't nest inside the frame's, so bake first
+    if (game_state_ && board_layer_dirty_ && state_ != UIState::MainMenu && state_ != UIState::Stats) {
+        bake_board_layer();
+    }
+    
+    frame_dirty_ = false;
+    if (game_state_) {
+        drawn_second_ = static_cast<int>(game_state_->get_elapsed_time());
+        drawn_solution_ready_ = game_state_->solution_ready();
+    }
+    
+    backend_->begin_frame();
+    backend_->clear(kBackground);
     
     switch (state_) {
         case UIState::MainMenu:
@@ -74,18 +146,24 @@ void UI::draw() {
             break;
     }
     
-    EndDrawing();
+    if (show_profiler_) draw_profiler_hud();
+    
+    // The frame's work ends here; end_frame waits for the frame rate
+    profiler_.end_frame();
+    backend_->end_frame();
 }
 
 void UI::draw_main_menu() {
+    PROFILE_PHASE(profiler_, DrawMenu);
+    
     // Title
     const char* title = "ECLIPSE";
-    int title_width = MeasureText(title, 80);
-    DrawText(title, (screen_width_ - title_width) / 2, 100, 80, Color{50, 50, 50, 255});
+    int title_width = backend_->measure_text(title, 80);
+    backend_->draw_text(title, (screen_width_ - title_width) / 2, 100, 80, Color{50, 50, 50, 255});
     
     const char* subtitle = "Daily Logic Puzzle";
-    int subtitle_width = MeasureText(subtitle, 30);
-    DrawText(subtitle, (screen_width_ - subtitle_width) / 2, 200, 30, Color{100, 100, 100, 255});
+    int subtitle_width = backend_->measure_text(subtitle, 30);
+    backend_->draw_text(subtitle, (screen_width_ - subtitle_width) / 2, 200, 30, Color{100, 100, 100, 255});
     
     // Buttons
     if (draw_button("Play Today's Puzzle", screen_width_/2 - 150, 300, 300, 60)) {
@@ -97,22 +175,24 @@ void UI::draw_main_menu() {
     }
     
     // Show today's date
-    DrawText(current_date_.c_str(), screen_width_/2 - 50, 480, 20, GRAY);
+    backend_->draw_text(current_date_.c_str(), screen_width_/2 - 50, 480, 20, GRAY);
     
     // Quick stats
     char stats_text[256];
     snprintf(stats_text, sizeof(stats_text), "Streak: %d | Solved: %d", 
              stats_.current_streak, stats_.total_solved);
-    int stats_width = MeasureText(stats_text, 20);
-    DrawText(stats_text, (screen_width_ - stats_width) / 2, 520, 20, DARKGRAY);
+    int stats_width = backend_->measure_text(stats_text, 20);
+    backend_->draw_text(stats_text, (screen_width_ - stats_width) / 2, 520, 20, DARKGRAY);
 }
 
 void UI::draw_game() {
+    PROFILE_PHASE(profiler_, DrawGame);
+    
     if (!game_state_) return;
     
     // Title
-    DrawText("ECLIPSE", 20, 20, 40, Color{50, 50, 50, 255});
-    DrawText(current_date_.c_str(), 20, 70, 20, GRAY);
+    backend_->draw_text("ECLIPSE", 20, 20, 40, Color{50, 50, 50, 255});
+    backend_->draw_text(current_date_.c_str(), 20, 70, 20, GRAY);
     
     // Timer
     int elapsed = static_cast<int>(game_state_->get_elapsed_time());
@@ -120,10 +200,11 @@ void UI::draw_game() {
     int seconds = elapsed % 60;
     char timer_text[32];
     snprintf(timer_text, sizeof(timer_text), "%02d:%02d", minutes, seconds);
-    DrawText(timer_text, screen_width_ - 150, 20, 40, Color{50, 50, 50, 255});
+    backend_->draw_text(timer_text, screen_width_ - 150, 20, 40, Color{50, 50, 50, 255});
     
-    // Board
-    draw_regions();
+    // Board: the baked static layers, the cells over them, then the clues
+    // on top so highlights don't wash them out
+    backend_->draw_board_layer(layout_.x(), layout_.y());
     draw_board();
     draw_clues();
     
@@ -132,115 +213,167 @@ void UI::draw_game() {
 }
 
 void UI::draw_board() {
-    const auto& puzzle = game_state_->puzzle();
-    int size = puzzle.size();
+    PROFILE_PHASE(profiler_, DrawBoard);
     
-    for (int row = 0; row < size; ++row) {
-        for (int col = 0; col < size; ++col) {
-            int x = board_offset_x_ + col * cell_size_;
-            int y = board_offset_y_ + row * cell_size_;
-            
-            draw_cell(row, col, x, y);
-        }
-    }
-}
-
-void UI::draw_cell(int row, int col, int x, int y) {
-    Rectangle rect = {static_cast<float>(x), static_cast<float>(y), 
-                     static_cast<float>(cell_size_), static_cast<float>(cell_size_)};
-    
-    // Highlight selected cell
-    if (selected_cell_ && selected_cell_->row == row && selected_cell_->col == col) {
-        DrawRectangleRec(rect, Color{200, 220, 255, 255});
-    }
+    const Grid& grid = game_state_->puzzle().grid();
+    int size = grid.size();
+    int cell_size = layout_.cell_size();
     
-    // Highlight hint
-    if (hint_highlight_ && hint_highlight_->row == row && hint_highlight_->col == col) {
-        DrawRectangleRec(rect, Color{255, 255, 150, 255});
-    }
+    // Cells and highlights are all sprites, drawn in one batch
+    backend_->begin_sprites(size * size + 2);
     
-    // Cell border
-    DrawRectangleLinesEx(rect, 2, Color{100, 100, 100, 255});
+    // Highlights sit inside the baked border and let the region show through
+    auto highlight = [&](Position pos, Color color) {
+        Rectangle rect = {static_cast<float>(layout_.cell_x(pos.col) + 2),
+                          static_cast<float>(layout_.cell_y(pos.row) + 2),
+                          static_cast<float>(cell_size - 4), static_cast<float>(cell_size - 4)};
+        backend_->draw_sprite(rect, Sprite::Fill, color);
+    };
+    if (selected_cell_) highlight(*selected_cell_, Color{200, 220, 255, 200});
+    if (hint_highlight_) highlight(*hint_highlight_, Color{255, 255, 150, 200});
     
-    // Draw symbol
-    Cell value = game_state_->get_cell(row, col);
-    if (value == Cell::Sun) {
-        DrawText("S", x + cell_size_/2 - 15, y + cell_size_/2 - 20, 40, Color{255, 200, 0, 255});
-    } else if (value == Cell::Moon) {
-        DrawText("M", x + cell_size_/2 - 15, y + cell_size_/2 - 20, 40, Color{100, 100, 200, 255});
+    for (int row = 0; row < size; ++row) {
+        for (Cell value : {Cell::Sun, Cell::Moon}) {
+            Sprite sprite = value == Cell::Sun ? Sprite::Sun : Sprite::Moon;
+            for (uint32_t bits = grid.row_bits(row, value); bits; bits &= bits - 1) {
+                backend_->draw_sprite(get_cell_rect(row, std::countr_zero(bits)), sprite, WHITE);
+            }
+        }
     }
+    
+    backend_->end_sprites();
 }
 
 void UI::draw_regions() {
+    PROFILE_PHASE(profiler_, DrawRegions);
+    
     const auto& puzzle = game_state_->puzzle();
     const auto& regions = puzzle.regions().get_regions();
+    int cell_size = layout_.cell_size();
     
     for (const auto& region : regions) {
         for (const auto& pos : region.cells) {
-            int x = board_offset_x_ + pos.col * cell_size_;
-            int y = board_offset_y_ + pos.row * cell_size_;
+            int x = layout_.cell_x(pos.col);
+            int y = layout_.cell_y(pos.row);
             
             Color region_color = get_region_color(region.id);
             region_color.a = 80;  // Semi-transparent
-            DrawRectangle(x + 2, y + 2, cell_size_ - 4, cell_size_ - 4, region_color);
+            backend_->draw_rectangle(x + 2, y + 2, cell_size - 4, cell_size - 4, region_color);
         }
-        
-        // Draw required suns count (on first cell of region)
-        if (!region.cells.empty()) {
-            const auto& first = region.cells[0];
-            int x = board_offset_x_ + first.col * cell_size_;
-            int y = board_offset_y_ + first.row * cell_size_;
-            
-            char count_text[8];
-            snprintf(count_text, sizeof(count_text), "%d", region.required_suns);
-            DrawText(count_text, x + 5, y + 5, 15, BLACK);
+    }
+}
+
+void UI::draw_cell_borders() {
+    int size = game_state_->puzzle().size();
+    
+    for (int row = 0; row < size; ++row) {
+        for (int col = 0; col < size; ++col) {
+            backend_->draw_rectangle_lines(get_cell_rect(row, col), 2, Color{100, 100, 100, 255});
         }
     }
 }
 
 void UI::draw_clues() {
+    PROFILE_PHASE(profiler_, DrawClues);
+    
     const auto& puzzle = game_state_->puzzle();
     const auto& clues = puzzle.get_clues();
+    int cell_size = layout_.cell_size();
+    int half = cell_size / 2;
+    
+    // Required suns count, on the first cell of each region
+    for (const auto& region : puzzle.regions().get_regions()) {
+        if (region.cells.empty()) continue;
+        
+        const auto& first = region.cells[0];
+        int x = layout_.cell_x(first.col);
+        int y = layout_.cell_y(first.row);
+        
+        char count_text[8];
+        snprintf(count_text, sizeof(count_text), "%d", region.required_suns);
+        backend_->draw_text(count_text, x + cell_size/12, y + cell_size/12, std::max(10, cell_size/4), BLACK);
+    }
     
     for (const auto& clue : clues) {
-        int x1 = board_offset_x_ + clue.cell1.col * cell_size_ + cell_size_ / 2;
-        int y1 = board_offset_y_ + clue.cell1.row * cell_size_ + cell_size_ / 2;
-        int x2 = board_offset_x_ + clue.cell2.col * cell_size_ + cell_size_ / 2;
-        int y2 = board_offset_y_ + clue.cell2.row * cell_size_ + cell_size_ / 2;
+        int x1 = layout_.cell_x(clue.cell1.col) + half;
+        int y1 = layout_.cell_y(clue.cell1.row) + half;
+        int x2 = layout_.cell_x(clue.cell2.col) + half;
+        int y2 = layout_.cell_y(clue.cell2.row) + half;
         
         int mid_x = (x1 + x2) / 2;
         int mid_y = (y1 + y2) / 2;
         
+        // Sized with the cells and centred on the shared edge
         const char* symbol = (clue.type == RelationshipClue::Equal) ? "=" : "≠";
-        DrawText(symbol, mid_x - 8, mid_y - 10, 20, RED);
+        int font_size = std::max(10, cell_size / 3);
+        backend_->draw_text(symbol, mid_x - backend_->measure_text(symbol, font_size) / 2,
+                            mid_y - font_size / 2, font_size, RED);
     }
 }
 
+void UI::bake_board_layer() {
+    PROFILE_PHASE(profiler_, DrawBoardLayer);
+    
+    backend_->begin_board_layer(layout_.pixels(), layout_.x(), layout_.y());
+    backend_->clear(kBackground);
+    draw_regions();
+    draw_cell_borders();
+    backend_->end_board_layer();
+    
+    backend_->build_sprites(layout_.cell_size());
+    board_layer_dirty_ = false;
+}
+
 void UI::draw_ui_panel() {
-    int panel_x = board_offset_x_ + game_state_->puzzle().size() * cell_size_ + 50;
-    int panel_y = board_offset_y_;
+    PROFILE_PHASE(profiler_, DrawPanel);
+    
+    int panel_x = layout_.x() + layout_.pixels() + 50;
+    int panel_y = layout_.y();
     
     // Hints used
     char hints_text[64];
     snprintf(hints_text, sizeof(hints_text), "Hints: %d", game_state_->hints_used());
-    DrawText(hints_text, panel_x, panel_y, 20, DARKGRAY);
+    backend_->draw_text(hints_text, panel_x, panel_y, 20, DARKGRAY);
+    
+    // Cells that can be deduced right now
+    char deducible_text[64];
+    snprintf(deducible_text, sizeof(deducible_text), "Can deduce: %d", game_state_->deducible_count());
+    backend_->draw_text(deducible_text, panel_x, panel_y + 22, 16, GRAY);
     
     // Hint buttons
     if (draw_button("Hint 1\n(Highlight)", panel_x, panel_y + 40, 120, 50)) {
+        PROFILE_PHASE(profiler_, Hints);
         hint_highlight_ = game_state_->get_hint_position(HintLevel::Highlight);
         game_state_->apply_hint(HintLevel::Highlight);
     }
     
     if (draw_button("Hint 2\n(Apply)", panel_x, panel_y + 100, 120, 50)) {
+        PROFILE_PHASE(profiler_, Hints);
         game_state_->apply_hint(HintLevel::Apply);
         hint_highlight_ = std::nullopt;
     }
     
-    if (draw_button("Hint 3\n(Reveal)", panel_x, panel_y + 160, 120, 50)) {
+    // Reveal needs the solution, which is still being worked out at first
+    bool can_reveal = game_state_->solution_ready();
+    if (draw_button(can_reveal ? "Hint 3\n(Reveal)" : "Hint 3\n(Solving...)", panel_x, panel_y + 160, 120, 50) &&
+        can_reveal) {
+        PROFILE_PHASE(profiler_, Hints);
         game_state_->apply_hint(HintLevel::Reveal);
         hint_highlight_ = std::nullopt;
     }
     
+    // Whether the board has gone wrong: a dead end propagation can see, or
+    // a cell that disagrees with the solution
+    {
+        PROFILE_PHASE(profiler_, Hints);
+        std::optional<int> mistakes = game_state_->mistakes();
+        if (game_state_->has_contradiction()) {
+            backend_->draw_text("Dead end - undo", panel_x, panel_y + 216, 16, RED);
+        } else if (mistakes && *mistakes > 0) {
+            backend_->draw_text("Off track", panel_x, panel_y + 216, 16, ORANGE);
+        }
+    }
+    
     // Undo/Redo
     if (draw_button("Undo", panel_x, panel_y + 240, 120, 40)) {
         game_state_->undo();
@@ -257,12 +390,14 @@ void UI::draw_ui_panel() {
     }
     
     // Instructions
-    DrawText("Click: Cycle", panel_x, screen_height_ - 150, 16, DARKGRAY);
-    DrawText("Empty->S->M", panel_x, screen_height_ - 130, 16, DARKGRAY);
+    backend_->draw_text("Click: Cycle", panel_x, screen_height_ - 150, 16, DARKGRAY);
+    backend_->draw_text("Empty->S->M", panel_x, screen_height_ - 130, 16, DARKGRAY);
 }
 
 void UI::draw_stats_screen() {
-    DrawText("STATISTICS", screen_width_/2 - 100, 100, 40, Color{50, 50, 50, 255});
+    PROFILE_PHASE(profiler_, DrawStats);
+    
+    backend_->draw_text("STATISTICS", screen_width_/2 - 100, 100, 40, Color{50, 50, 50, 255});
     
     char stats_lines[512];
     snprintf(stats_lines, sizeof(stats_lines),
@@ -277,7 +412,7 @@ void UI::draw_stats_screen() {
              stats_.total_hints_used,
              stats_.average_solve_time);
     
-    DrawText(stats_lines, screen_width_/2 - 150, 200, 24, DARKGRAY);
+    backend_->draw_text(stats_lines, screen_width_/2 - 150, 200, 24, DARKGRAY);
     
     if (draw_button("Back", screen_width_/2 - 75, 550, 150, 50)) {
         state_ = UIState::MainMenu;
@@ -285,27 +420,29 @@ void UI::draw_stats_screen() {
 }
 
 void UI::draw_completed_screen() {
+    PROFILE_PHASE(profiler_, DrawCompleted);
+    
     draw_game();
     
     // Overlay
-    DrawRectangle(0, 0, screen_width_, screen_height_, Color{0, 0, 0, 180});
+    backend_->draw_rectangle(0, 0, screen_width_, screen_height_, Color{0, 0, 0, 180});
     
     // Completion message
-    DrawText("PUZZLE SOLVED!", screen_width_/2 - 150, 200, 40, WHITE);
+    backend_->draw_text("PUZZLE SOLVED!", screen_width_/2 - 150, 200, 40, WHITE);
     
     int minutes = static_cast<int>(game_state_->get_elapsed_time() / 60);
     int seconds = static_cast<int>(game_state_->get_elapsed_time()) % 60;
     char time_text[64];
     snprintf(time_text, sizeof(time_text), "Time: %dm %ds", minutes, seconds);
-    DrawText(time_text, screen_width_/2 - 80, 260, 24, WHITE);
+    backend_->draw_text(time_text, screen_width_/2 - 80, 260, 24, WHITE);
     
     char hints_text[64];
     snprintf(hints_text, sizeof(hints_text), "Hints Used: %d", game_state_->hints_used());
-    DrawText(hints_text, screen_width_/2 - 80, 300, 24, WHITE);
+    backend_->draw_text(hints_text, screen_width_/2 - 80, 300, 24, WHITE);
     
     if (draw_button("Share", screen_width_/2 - 75, 360, 150, 50)) {
         std::string share_text = game_state_->generate_share_text(current_date_);
-        SetClipboardText(share_text.c_str());
+        backend_->set_clipboard(share_text.c_str());
     }
     
     if (draw_button("Menu", screen_width_/2 - 75, 430, 150, 50)) {
@@ -314,62 +451,96 @@ void UI::draw_completed_screen() {
 }
 
 void UI::handle_input() {
+    PROFILE_PHASE(profiler_, Input);
+    
+    if (FrameProfiler::kEnabled && backend_->key_pressed(KEY_F3)) {
+        show_profiler_ = !show_profiler_;
+        frame_dirty_ = true;
+    }
+    
     if (state_ == UIState::Playing) {
-        if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-            handle_cell_click(GetMouseX(), GetMouseY());
+        if (backend_->mouse_pressed()) {
+            Vector2 mouse = backend_->mouse_position();
+            handle_cell_click(static_cast<int>(mouse.x), static_cast<int>(mouse.y));
         }
         
         handle_keyboard();
         
         // Check if solved
-        if (game_state_ && game_state_->is_solved()) {
+        bool solved = false;
+        if (game_state_) {
+            PROFILE_PHASE(profiler_, SolvedCheck);
+            solved = game_state_->is_solved();
+        }
+        if (solved) {
             complete_puzzle();
         }
     }
 }
 
+void UI::draw_profiler_hud() {
+    // Averages over the last frames drawn, in a box at the bottom left
+    int x = 10;
+    int y = screen_height_ - 30 - 16 * (FrameProfiler::kPhases + 2);
+    backend_->draw_rectangle(x - 5, y - 5, 300, 16 * (FrameProfiler::kPhases + 2) + 10, Color{0, 0, 0, 170});
+    
+    char line[96];
+    snprintf(line, sizeof(line), "frame %.2f ms (max %.2f), %d frames",
+             profiler_.average_frame_ms(), profiler_.max_frame_ms(), profiler_.frames_recorded());
+    backend_->draw_text(line, x, y, 14, WHITE);
+    y += 16;
+    
+    snprintf(line, sizeof(line), "allocations %.1f per frame", profiler_.average_allocations());
+    backend_->draw_text(line, x, y, 14, WHITE);
+    y += 16;
+    
+    for (int i = 0; i < FrameProfiler::kPhases; ++i) {
+        FramePhase phase = static_cast<FramePhase>(i);
+        snprintf(line, sizeof(line), "%-22s %.3f ms", phase_name(phase), profiler_.average_ms(phase));
+        backend_->draw_text(line, x, y, 14, LIGHTGRAY);
+        y += 16;
+    }
+}
+
 void UI::handle_cell_click(int mouse_x, int mouse_y) {
     if (!game_state_) return;
     
-    int size = game_state_->puzzle().size();
+    auto cell = layout_.cell_at(mouse_x, mouse_y);
+    if (!cell) return;
     
-    for (int row = 0; row < size; ++row) {
-        for (int col = 0; col < size; ++col) {
-            Rectangle rect = get_cell_rect(row, col);
-            if (CheckCollisionPointRec({static_cast<float>(mouse_x), static_cast<float>(mouse_y)}, rect)) {
-                selected_cell_ = Position{row, col};
-                
-                // Cycle through values
-                Cell current = game_state_->get_cell(row, col);
-                Cell next = Cell::Empty;
-                
-                if (current == Cell::Empty) next = Cell::Sun;
-                else if (current == Cell::Sun) next = Cell::Moon;
-                else next = Cell::Empty;
-                
-                game_state_->set_cell(row, col, next);
-                hint_highlight_ = std::nullopt;
-                return;
-            }
-        }
-    }
+    selected_cell_ = cell;
+    
+    // Cycle through values
+    Cell current = game_state_->get_cell(cell->row, cell->col);
+    Cell next = Cell::Empty;
+    
+    if (current == Cell::Empty) next = Cell::Sun;
+    else if (current == Cell::Sun) next = Cell::Moon;
+    else next = Cell::Empty;
+    
+    game_state_->set_cell(cell->row, cell->col, next);
+    hint_highlight_ = std::nullopt;
 }
 
 void UI::handle_keyboard() {
     if (!game_state_) return;
     
     // Undo/Redo
-    if (IsKeyPressed(KEY_Z) && (IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_LEFT_SUPER))) {
+    if (backend_->key_pressed(KEY_Z) && (backend_->key_down(KEY_LEFT_CONTROL) || backend_->key_down(KEY_LEFT_SUPER))) {
         game_state_->undo();
+        frame_dirty_ = true;
     }
-    if (IsKeyPressed(KEY_Y) && (IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_LEFT_SUPER))) {
+    if (backend_->key_pressed(KEY_Y) && (backend_->key_down(KEY_LEFT_CONTROL) || backend_->key_down(KEY_LEFT_SUPER))) {
         game_state_->redo();
+        frame_dirty_ = true;
     }
     
     // Hints
-    if (IsKeyPressed(KEY_H)) {
+    if (backend_->key_pressed(KEY_H)) {
+        PROFILE_PHASE(profiler_, Hints);
         hint_highlight_ = game_state_->get_hint_position(HintLevel::Highlight);
         game_state_->apply_hint(HintLevel::Highlight);
+        frame_dirty_ = true;
     }
 }
 
@@ -382,7 +553,7 @@ void UI::load_daily_puzzle() {
     auto progress = persistence_->load_daily_progress(current_date_);
     
     // Generate puzzle
-    uint32_t seed = DailySeed::get_today_seed();
+    uint32_t seed = DailySeed::get_seed_for_date(current_date_);
     GeneratorConfig config;
     config.seed = seed;
     config.grid_size = 6;
@@ -395,12 +566,26 @@ void UI::load_daily_puzzle() {
     
     game_state_ = std::make_unique<GameState>(std::move(puzzle));
     game_state_->start_timer();
+    update_layout();
     
     state_ = UIState::Playing;
     selected_cell_ = std::nullopt;
     hint_highlight_ = std::nullopt;
 }
 
+void UI::update_layout() {
+    screen_width_ = backend_->screen_width();
+    screen_height_ = backend_->screen_height();
+    frame_dirty_ = true;
+    if (!game_state_) return;
+    
+    // Room for the title above, the side panel to the right and a margin
+    // below; cells no larger than the original 60 pixels
+    layout_ = BoardLayout::fit(game_state_->puzzle().size(), 100, 150,
+                               screen_width_ - 100 - 220, screen_height_ - 150 - 50, 60);
+    board_layer_dirty_ = true;
+}
+
 void UI::complete_puzzle() {
     game_state_->pause_timer();
     state_ = UIState::Completed;
@@ -454,10 +639,10 @@ Color UI::get_region_color(int region_id) const {
 
 Rectangle UI::get_cell_rect(int row, int col) const {
     return Rectangle{
-        static_cast<float>(board_offset_x_ + col * cell_size_),
-        static_cast<float>(board_offset_y_ + row * cell_size_),
-        static_cast<float>(cell_size_),
-        static_cast<float>(cell_size_)
+        static_cast<float>(layout_.cell_x(col)),
+        static_cast<float>(layout_.cell_y(row)),
+        static_cast<float>(layout_.cell_size()),
+        static_cast<float>(layout_.cell_size())
     };
 }
 
@@ -465,16 +650,21 @@ bool UI::draw_button(const char* text, int x, int y, int width, int height) {
     Rectangle rect = {static_cast<float>(x), static_cast<float>(y), 
                      static_cast<float>(width), static_cast<float>(height)};
     
-    bool hovered = CheckCollisionPointRec(GetMousePosition(), rect);
-    bool clicked = hovered && IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
+    Vector2 mouse = backend_->mouse_position();
+    bool hovered = mouse.x >= rect.x && mouse.x < rect.x + rect.width &&
+                   mouse.y >= rect.y && mouse.y < rect.y + rect.height;
+    bool clicked = hovered && backend_->mouse_pressed();
+    
+    // The click's effects show on the next frame
+    if (clicked) frame_dirty_ = true;
     
     Color button_color = hovered ? Color{100, 150, 200, 255} : Color{70, 120, 180, 255};
     
-    DrawRectangleRounded(rect, 0.2f, 8, button_color);
+    backend_->draw_rectangle_rounded(rect, 0.2f, button_color);
     
     // Center text
-    int text_width = MeasureText(text, 20);
-    DrawText(text, x + (width - text_width) / 2, y + (height - 20) / 2, 20, WHITE);
+    int text_width = backend_->measure_text(text, 20);
+    backend_->draw_text(text, x + (width - text_width) / 2, y + (height - 20) / 2, 20, WHITE);
     
     return clicked;
 }
@@ -1,10 +1,14 @@
 #pragma once
 
 #include "game_state.h"
+#include "backend.h"
 #include "persistence.h"
+#include "board_layout.h"
+#include "frame_profiler.h"
 #include <raylib.h>
 #include <memory>
 #include <optional>
+#include <string>
 
 namespace eclipse {
 
@@ -18,19 +22,37 @@ enum class UIState {
 
 class UI {
 public:
-    UI();
+    // The UI draws and reads input through backend; stats and progress
+    // are kept under data_dir
+    explicit UI(std::unique_ptr<Backend> backend, const std::string& data_dir = default_data_dir());
     ~UI();
     
+    static std::string default_data_dir();
+    
     // Initialize the UI
     bool init();
     
     // Run the main game loop
     void run();
     
+    // One pass of the main loop: input, then a frame if anything changed.
+    // run() calls it until the window closes; a headless driver can call
+    // it directly.
+    void frame();
+    
+    // Play the daily puzzle of date (YYYY-MM-DD) rather than today's, e.g.
+    // for a reproducible headless run; call after init()
+    void set_date(const std::string& date) { current_date_ = date; }
+    
+    // The game in progress, or nullptr before one is started
+    const GameState* game_state() const { return game_state_.get(); }
+    
 private:
-    // Screen dimensions
-    const int screen_width_ = 1000;
-    const int screen_height_ = 800;
+    std::unique_ptr<Backend> backend_;
+    
+    // Screen dimensions; the window can be resized
+    int screen_width_ = 1000;
+    int screen_height_ = 800;
     
     // UI state
     UIState state_ = UIState::MainMenu;
@@ -42,31 +64,57 @@ private:
     std::string current_date_;
     
     // UI elements
-    int cell_size_ = 60;
-    int board_offset_x_ = 100;
-    int board_offset_y_ = 150;
+    BoardLayout layout_;
     
     // Interaction state
     std::optional<Position> selected_cell_;
     std::optional<Position> hint_highlight_;
     
+    // Region fills and borders don't change during a puzzle: they are
+    // drawn into the backend's board layer once per puzzle and copied to
+    // the screen each frame, with only the cell contents drawn over them.
+    // Cell symbols and highlights are sprites, rebuilt with the layer. The
+    // clues and region counts are a few lines of text drawn last, so no
+    // highlight covers them.
+    bool board_layer_dirty_ = true;
+    
+    // Frames are only drawn when something on screen may have changed:
+    // input, the timer's second ticking over or the solution arriving.
+    // In between, the loop sleeps at a low rate.
+    bool frame_dirty_ = true;
+    bool idle_ = false;
+    int drawn_second_ = -1;
+    bool drawn_solution_ready_ = false;
+    
+    // Where frame time goes; F3 shows it in debug builds
+    FrameProfiler profiler_;
+    bool show_profiler_ = false;
+    
+    bool needs_redraw() const;
+    void set_idle(bool idle);
+    
     // Drawing functions
     void draw();
     void draw_main_menu();
     void draw_game();
     void draw_board();
-    void draw_cell(int row, int col, int x, int y);
     void draw_regions();
+    void draw_cell_borders();
     void draw_clues();
+    void bake_board_layer();
     void draw_ui_panel();
     void draw_stats_screen();
     void draw_completed_screen();
+    void draw_profiler_hud();
     
     // Input handling
     void handle_input();
     void handle_cell_click(int mouse_x, int mouse_y);
     void handle_keyboard();
     
+    // Fit the board to the window; after a resize or a new puzzle
+    void update_layout();
+    
     // Game management
     void start_new_game();
     void load_daily_puzzle();
@@ -2,56 +2,138 @@
 
 #include "grid.h"
 #include "region.h"
+#include "rules.h"
 #include <vector>
 #include <map>
 #include <bitset>
+#include <memory>
+#include <memory_resource>
 
 namespace eclipse {
 
-// Relationship clue between two adjacent cells
-struct Clue {
-    Position cell1;
-    Position cell2;
-    RelationshipClue type;
+// Rules broken by a board, per rule of StandardRules
+using ViolationCounts = StandardRules::Counts;
+
+// The fixed layout of a puzzle: its regions and relationship clues.
+// Shared, reference-counted and never modified once shared, so any number
+// of puzzle states (solver copies, carving attempts, parallel workers) can
+// point at one layout while each owns only its grid.
+struct PuzzleTopology {
+    explicit PuzzleTopology(int size, Grid::allocator_type alloc = {})
+        : regions(size, alloc), clues(alloc) {}
+    PuzzleTopology(const PuzzleTopology& other, Grid::allocator_type alloc)
+        : regions(other.regions, alloc), clues(other.clues, alloc) {}
+    
+    RegionManager regions;
+    std::pmr::vector<Clue> clues;
 };
 
-// Puzzle contains all the constraints
+// Puzzle contains all the constraints.
+//
+// Not safe to share between threads, not even for const use: queries such
+// as is_valid() and violations() rebind and recount cached state on the
+// way. Give each thread its own copy instead; copies share the topology,
+// which is never written once shared, so they are cheap and independent.
 class Puzzle {
 public:
-    explicit Puzzle(int size = 6);
+    using allocator_type = Grid::allocator_type;
+    
+    // The grid, and any topology this puzzle creates, are allocated from
+    // alloc (the default heap unless given)
+    explicit Puzzle(int size = 6, allocator_type alloc = {});
+    
+    // Copies share the topology when it already lives on the copy's
+    // resource (the default heap for a plain copy, alloc for the
+    // allocator-extended one) and take their own copy of it otherwise, so
+    // a copy never points into another resource's memory
+    Puzzle(const Puzzle& other);
+    Puzzle(Puzzle&& other) = default;
+    Puzzle(const Puzzle& other, allocator_type alloc);
+    Puzzle& operator=(const Puzzle& other);
+    Puzzle& operator=(Puzzle&& other) = default;
+    
+    // Independent copy with the grid and the topology both on alloc; use it
+    // to take a puzzle out of an arena before the arena is released
+    Puzzle clone(allocator_type alloc = {}) const;
     
     Grid& grid() { return grid_; }
     const Grid& grid() const { return grid_; }
     
-    RegionManager& regions() { return regions_; }
-    const RegionManager& regions() const { return regions_; }
+    const RegionManager& regions() const { return topology_->regions; }
+    
+    // Copies the topology first unless this puzzle is its only owner (copy
+    // on write); don't hold the reference across a copy of the puzzle
+    RegionManager& mutable_regions() { return mutable_topology().regions; }
+    
+    // Shared layout; copying a Puzzle copies the grid and this pointer only
+    std::shared_ptr<const PuzzleTopology> topology() const { return topology_; }
+    void set_topology(std::shared_ptr<const PuzzleTopology> topology);
     
     // Clue management
     void add_clue(const Clue& clue);
-    const std::vector<Clue>& get_clues() const { return clues_; }
+    const std::pmr::vector<Clue>& get_clues() const { return topology_->clues; }
     RelationshipClue get_clue(Position pos1, Position pos2) const;
     
+    // Set a cell and update the violation counts in O(1). Writing through
+    // grid() is fine as well; the counts are then rebuilt on the next query.
+    void set(int row, int col, Cell value);
+    
     // Check if a value violates constraints
     bool is_valid_placement(int row, int col, Cell value) const;
     
-    // Check if entire grid is valid
+    // Check if entire grid is valid; O(1) while the grid changes through set()
     bool is_valid() const;
     
+    // Complete and valid
+    bool is_solved() const;
+    
+    // Constraints the current grid breaks
+    const ViolationCounts& violations() const;
+    
+    // Filled cells of a row that take part in a broken constraint, bit c
+    // for column c; a cell is set exactly when is_valid() would reject it
+    uint32_t conflict_bits(int row) const;
+    
     // Get possible values for a cell (based on constraints)
     std::bitset<3> get_possible_values(int row, int col) const;
     
+    // Legal values of every empty cell in one pass. Row, column and region
+    // counts are taken once and the rules are applied a whole row at a
+    // time; equivalent to get_possible_values on each empty cell.
+    void compute_candidates(CandidateMasks& masks) const;
+    
     int size() const { return grid_.size(); }
     
 private:
     Grid grid_;
-    RegionManager regions_;
-    std::vector<Clue> clues_;
-    
-    // Helper constraint checkers
-    bool check_row_col_count(int row, int col, Cell value) const;
-    bool check_no_three_adjacent(int row, int col, Cell value) const;
-    bool check_region_constraint(int row, int col, Cell value) const;
-    bool check_relationship_clues(int row, int col, Cell value) const;
+    std::shared_ptr<const PuzzleTopology> topology_;
+    
+    // The topology this puzzle allocated itself, the only one it may write
+    // to, and only while topology_ still points at it and isn't shared
+    PuzzleTopology* owned_ = nullptr;
+    
+    // Rule state bound to the layout, and violation counts of grid_. Both
+    // are caches: rules_ is rebound when rules_bound_ is cleared, the counts
+    // are recounted unless synced_ is set and the grid is still at
+    // synced_revision_. Written by const queries without any locking, which
+    // is why a Puzzle can't be shared between threads.
+    mutable StandardRules rules_;
+    mutable bool rules_bound_ = false;
+    mutable ViolationCounts violations_;
+    mutable bool synced_ = false;
+    mutable uint64_t synced_revision_ = 0;
+    
+    // The topology, copied first unless this puzzle is its only owner
+    PuzzleTopology& mutable_topology();
+    
+    // Replace the topology with an owned copy on alloc
+    void copy_topology(allocator_type alloc);
+    
+    // Bind the rules to the current layout if it changed
+    const StandardRules& rules() const;
+    
+    // Recount the violations if the grid or layout changed
+    void sync() const;
 };
 
 } // namespace eclipse
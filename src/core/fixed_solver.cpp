@@ -0,0 +1,31 @@
+#include "fixed_solver.h"
+#include "solver.h"
+
+namespace eclipse {
+
+namespace {
+
+template <int N>
+int count_with_basic_solver(const Puzzle& puzzle, int max_count) {
+    BasicSolver<N> solver(puzzle);
+    return solver.count_solutions(max_count);
+}
+
+int count_with_solver(const Puzzle& puzzle, int max_count) {
+    Puzzle copy(puzzle, puzzle.grid().get_allocator());
+    Solver solver(copy);
+    return solver.count_solutions(max_count);
+}
+
+} // namespace
+
+SolutionCounter solution_counter_for_size(int size) {
+    // The sizes the game ships
+    switch (size) {
+        case 6: return &count_with_basic_solver<6>;
+        case 8: return &count_with_basic_solver<8>;
+        default: return &count_with_solver;
+    }
+}
+
+} // namespace eclipse
@@ -0,0 +1,349 @@
+#pragma once
+
+#include "constraints.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+namespace eclipse {
+
+// Puzzle state specialised for a board size known at compile time.
+// Rows and columns are fixed-width masks, neighbour lookups come from
+// constexpr tables and every per-line loop has a constant trip count, so
+// the compiler can unroll the rule checks for the sizes the game ships.
+//
+// candidates() applies the rules of StandardRules fused by hand; the
+// assertion below stops a rule being added there without it.
+template <int N>
+class BasicPuzzle {
+public:
+    static_assert(N >= 4 && N <= 16 && N % 2 == 0, "BasicPuzzle supports even sizes 4..16");
+    static_assert(std::is_same_v<StandardRules,
+                                 RuleSet<LineBalanceRule, NoThreeRule, RegionRule, ClueRule>>,
+                  "BasicPuzzle::candidates() must apply every rule of StandardRules");
+
+    using Mask = std::conditional_t<(N <= 8), uint8_t, uint16_t>;
+
+    static constexpr int kSize = N;
+    static constexpr int kCells = N * N;
+    static constexpr int kHalf = N / 2;
+    static constexpr uint32_t kFull = (uint32_t{1} << N) - 1;
+    static constexpr uint8_t kNoRegion = 0xFF;
+
+    // Orthogonal neighbours of every cell: up, down, left, right (-1 if none)
+    static constexpr std::array<std::array<int16_t, 4>, kCells> kNeighbours = [] {
+        std::array<std::array<int16_t, 4>, kCells> table{};
+        for (int r = 0; r < N; ++r) {
+            for (int c = 0; c < N; ++c) {
+                auto& n = table[r * N + c];
+                n[0] = static_cast<int16_t>(r > 0 ? (r - 1) * N + c : -1);
+                n[1] = static_cast<int16_t>(r < N - 1 ? (r + 1) * N + c : -1);
+                n[2] = static_cast<int16_t>(c > 0 ? r * N + c - 1 : -1);
+                n[3] = static_cast<int16_t>(c < N - 1 ? r * N + c + 1 : -1);
+            }
+        }
+        return table;
+    }();
+
+    // Throws std::invalid_argument if the puzzle isn't N x N or has more
+    // regions than kNoRegion leaves room for
+    explicit BasicPuzzle(const Puzzle& puzzle) {
+        const Grid& grid = puzzle.grid();
+        const RegionManager& regions = puzzle.regions();
+
+        if (puzzle.size() != N) {
+            throw std::invalid_argument("Puzzle size does not match BasicPuzzle");
+        }
+
+        // Dense region indices must stay below kNoRegion
+        if (regions.region_count() > static_cast<int>(kNoRegion)) {
+            throw std::invalid_argument("Too many regions for BasicPuzzle");
+        }
+        num_regions_ = regions.region_count();
+        for (int i = 0; i < num_regions_; ++i) {
+            required_[i] = regions.region_at(i).required_suns;
+        }
+
+        for (int r = 0; r < N; ++r) {
+            for (int c = 0; c < N; ++c) {
+                int index = r * N + c;
+
+                region_of_[index] = kNoRegion;
+                int dense = regions.get_cell_region_index(r, c);
+                if (dense != -1) {
+                    region_of_[index] = static_cast<uint8_t>(dense);
+                    region_rows_[dense][r] |= static_cast<Mask>(1u << c);
+                    region_empty_[dense]++;
+                }
+
+                for (int dir = 0; dir < 4; ++dir) {
+                    int other = kNeighbours[index][dir];
+                    if (other < 0) continue;
+
+                    RelationshipClue clue = puzzle.get_clue({r, c}, {other / N, other % N});
+                    if (clue == RelationshipClue::Equal) equal_dirs_[index] |= 1u << dir;
+                    if (clue == RelationshipClue::NotEqual) not_equal_dirs_[index] |= 1u << dir;
+                }
+            }
+        }
+
+        for (int r = 0; r < N; ++r) {
+            for (int c = 0; c < N; ++c) {
+                Cell value = grid.get(r, c);
+                if (value != Cell::Empty) place(r, c, value);
+            }
+        }
+    }
+
+    Cell get(int row, int col) const { return cells_[row * N + col]; }
+
+    uint32_t empty_bits(int row) const {
+        return kFull & ~static_cast<uint32_t>(sun_rows_[row] | moon_rows_[row]);
+    }
+
+    void place(int row, int col, Cell value) {
+        int index = row * N + col;
+        cells_[index] = value;
+
+        Mask row_bit = static_cast<Mask>(1u << col);
+        Mask col_bit = static_cast<Mask>(1u << row);
+        if (value == Cell::Sun) {
+            sun_rows_[row] |= row_bit;
+            sun_cols_[col] |= col_bit;
+        } else {
+            moon_rows_[row] |= row_bit;
+            moon_cols_[col] |= col_bit;
+        }
+
+        uint8_t region = region_of_[index];
+        if (region != kNoRegion) {
+            region_empty_[region]--;
+            if (value == Cell::Sun) region_suns_[region]++;
+        }
+    }
+
+    void clear(int row, int col) {
+        int index = row * N + col;
+        Cell value = cells_[index];
+        cells_[index] = Cell::Empty;
+
+        Mask row_bit = static_cast<Mask>(1u << col);
+        Mask col_bit = static_cast<Mask>(1u << row);
+        if (value == Cell::Sun) {
+            sun_rows_[row] &= static_cast<Mask>(~row_bit);
+            sun_cols_[col] &= static_cast<Mask>(~col_bit);
+        } else {
+            moon_rows_[row] &= static_cast<Mask>(~row_bit);
+            moon_cols_[col] &= static_cast<Mask>(~col_bit);
+        }
+
+        uint8_t region = region_of_[index];
+        if (region != kNoRegion) {
+            region_empty_[region]++;
+            if (value == Cell::Sun) region_suns_[region]--;
+        }
+    }
+
+    // Legal values for every empty cell, one mask per row
+    void candidates(std::array<Mask, N>& sun, std::array<Mask, N>& moon) const {
+        uint32_t col_sun_open = 0;
+        uint32_t col_moon_open = 0;
+        for (int c = 0; c < N; ++c) {
+            if (std::popcount(static_cast<uint32_t>(sun_cols_[c])) < kHalf) col_sun_open |= 1u << c;
+            if (std::popcount(static_cast<uint32_t>(moon_cols_[c])) < kHalf) col_moon_open |= 1u << c;
+        }
+
+        for (int r = 0; r < N; ++r) {
+            uint32_t suns = sun_rows_[r];
+            uint32_t moons = moon_rows_[r];
+            uint32_t empty = kFull & ~(suns | moons);
+
+            uint32_t sun_ok = std::popcount(suns) < kHalf ? empty & col_sun_open : 0;
+            uint32_t moon_ok = std::popcount(moons) < kHalf ? empty & col_moon_open : 0;
+
+            sun[r] = static_cast<Mask>(sun_ok & ~triples(sun_rows_, r));
+            moon[r] = static_cast<Mask>(moon_ok & ~triples(moon_rows_, r));
+        }
+
+        for (int i = 0; i < num_regions_; ++i) {
+            bool sun_blocked = region_suns_[i] >= required_[i];
+            bool moon_blocked = required_[i] - region_suns_[i] > region_empty_[i] - 1;
+            if (!sun_blocked && !moon_blocked) continue;
+
+            for (int r = 0; r < N; ++r) {
+                if (sun_blocked) sun[r] &= static_cast<Mask>(~region_rows_[i][r]);
+                if (moon_blocked) moon[r] &= static_cast<Mask>(~region_rows_[i][r]);
+            }
+        }
+
+        for (int index = 0; index < kCells; ++index) {
+            uint8_t dirs = equal_dirs_[index] | not_equal_dirs_[index];
+            if (!dirs || cells_[index] != Cell::Empty) continue;
+
+            Mask bit = static_cast<Mask>(1u << (index % N));
+            for (int dir = 0; dir < 4; ++dir) {
+                if (!((dirs >> dir) & 1u)) continue;
+
+                Cell other = cells_[kNeighbours[index][dir]];
+                if (other == Cell::Empty) continue;
+
+                bool equal = (equal_dirs_[index] >> dir) & 1u;
+                Cell forbidden = equal ? (other == Cell::Sun ? Cell::Moon : Cell::Sun) : other;
+                auto& target = forbidden == Cell::Sun ? sun : moon;
+                target[index / N] &= static_cast<Mask>(~bit);
+            }
+        }
+    }
+
+private:
+    std::array<Cell, kCells> cells_{};
+    std::array<Mask, N> sun_rows_{};
+    std::array<Mask, N> moon_rows_{};
+    std::array<Mask, N> sun_cols_{};
+    std::array<Mask, N> moon_cols_{};
+
+    int num_regions_ = 0;
+    std::array<uint8_t, kCells> region_of_{};
+    std::array<std::array<Mask, N>, kNoRegion> region_rows_{};
+    std::array<int, kNoRegion> required_{};
+    std::array<int, kNoRegion> region_suns_{};
+    std::array<int, kNoRegion> region_empty_{};
+
+    // Clue directions per cell, bit i matching kNeighbours[cell][i]
+    std::array<uint8_t, kCells> equal_dirs_{};
+    std::array<uint8_t, kCells> not_equal_dirs_{};
+
+    // Cells of a row that would complete a line of three equal values
+    static uint32_t triples(const std::array<Mask, N>& rows, int row) {
+        auto bits = [&](int r) -> uint32_t { return (r >= 0 && r < N) ? rows[r] : 0u; };
+        uint32_t x = bits(row);
+        uint32_t horizontal = ((x >> 1) & (x >> 2)) | ((x << 1) & (x << 2)) | ((x << 1) & (x >> 1));
+        uint32_t vertical = (bits(row - 1) & bits(row - 2)) |
+                            (bits(row + 1) & bits(row + 2)) |
+                            (bits(row - 1) & bits(row + 1));
+        return (horizontal | vertical) & kFull;
+    }
+};
+
+// Iterative MRV search over a BasicPuzzle, with a fixed-size decision stack
+template <int N>
+class BasicSolver {
+public:
+    explicit BasicSolver(const Puzzle& puzzle)
+        : state_(puzzle), givens_valid_(puzzle.is_valid()) {
+        for (int r = 0; r < N; ++r) {
+            for (int c = 0; c < N; ++c) {
+                if (state_.get(r, c) == Cell::Empty) empty_count_++;
+            }
+        }
+    }
+
+    // Count solutions up to a maximum; the state is restored afterwards
+    int count_solutions(int max_count) {
+        if (!givens_valid_) return 0;
+
+        int count = 0;
+        depth_ = 0;
+
+        while (count < max_count) {
+            if (empty_count_ == 0) {
+                count++;
+                if (!backtrack()) break;
+                continue;
+            }
+
+            Decision decision;
+            if (!find_best_cell(decision)) {
+                if (!backtrack()) break;
+                continue;
+            }
+
+            state_.place(decision.row, decision.col, decision.value);
+            stack_[depth_++] = decision;
+            empty_count_--;
+        }
+
+        while (depth_ > 0) {
+            const Decision& top = stack_[--depth_];
+            state_.clear(top.row, top.col);
+            empty_count_++;
+        }
+        return count;
+    }
+
+private:
+    using Mask = typename BasicPuzzle<N>::Mask;
+
+    struct Decision {
+        int row = 0;
+        int col = 0;
+        Cell value = Cell::Empty;
+        bool moon_pending = false;
+    };
+
+    BasicPuzzle<N> state_;
+    bool givens_valid_;
+    int empty_count_ = 0;
+    int depth_ = 0;
+    std::array<Decision, N * N> stack_{};
+    std::array<Mask, N> sun_{};
+    std::array<Mask, N> moon_{};
+
+    bool backtrack() {
+        while (depth_ > 0) {
+            Decision& top = stack_[depth_ - 1];
+            state_.clear(top.row, top.col);
+
+            if (top.moon_pending) {
+                top.value = Cell::Moon;
+                top.moon_pending = false;
+                state_.place(top.row, top.col, Cell::Moon);
+                return true;
+            }
+
+            depth_--;
+            empty_count_++;
+        }
+        return false;
+    }
+
+    bool find_best_cell(Decision& decision) {
+        state_.candidates(sun_, moon_);
+
+        bool have_pair = false;
+        for (int r = 0; r < N; ++r) {
+            uint32_t sun = sun_[r];
+            uint32_t moon = moon_[r];
+            uint32_t empty = state_.empty_bits(r);
+
+            uint32_t decisive = (empty & ~(sun | moon)) | (sun ^ moon);
+            if (decisive) {
+                int c = std::countr_zero(decisive);
+                bool has_sun = (sun >> c) & 1u;
+                bool has_moon = (moon >> c) & 1u;
+                if (!has_sun && !has_moon) return false;
+
+                decision = {r, c, has_sun ? Cell::Sun : Cell::Moon, false};
+                return true;
+            }
+
+            if (!have_pair && (sun & moon)) {
+                decision = {r, std::countr_zero(sun & moon), Cell::Sun, true};
+                have_pair = true;
+            }
+        }
+        return have_pair;
+    }
+};
+
+// Counts solutions of a puzzle (up to max_count) without modifying it
+using SolutionCounter = int (*)(const Puzzle& puzzle, int max_count);
+
+// Picks the BasicSolver instantiation for a board size, or the generic
+// Solver for sizes without one
+SolutionCounter solution_counter_for_size(int size);
+
+} // namespace eclipse
@@ -0,0 +1,74 @@
+#include "forced_moves.h"
+#include <bit>
+
+namespace eclipse {
+
+ForcedMoves::ForcedMoves(const Puzzle& puzzle) {
+    rebuild(puzzle);
+}
+
+void ForcedMoves::rebuild(const Puzzle& puzzle) {
+    CandidateMasks candidates;
+    puzzle.compute_candidates(candidates);
+
+    int size = puzzle.size();
+    sun_.assign(size, 0);
+    moon_.assign(size, 0);
+    count_ = 0;
+
+    for (int r = 0; r < size; ++r) {
+        uint32_t single = candidates.sun[r] ^ candidates.moon[r];
+        sun_[r] = single & candidates.sun[r];
+        moon_[r] = single & candidates.moon[r];
+        count_ += std::popcount(single);
+    }
+}
+
+void ForcedMoves::update(const Puzzle& puzzle, int row, int col) {
+    int size = puzzle.size();
+    for (int i = 0; i < size; ++i) {
+        refresh(puzzle, row, i);
+        if (i != row) refresh(puzzle, i, col);
+    }
+
+    const RegionManager& regions = puzzle.regions();
+    int index = regions.get_cell_region_index(row, col);
+    if (index == -1) return;
+
+    for (Position pos : regions.region_at(index).cells) {
+        if (pos.row != row && pos.col != col) refresh(puzzle, pos.row, pos.col);
+    }
+}
+
+std::optional<Position> ForcedMoves::first() const {
+    for (int r = 0; r < static_cast<int>(sun_.size()); ++r) {
+        uint32_t forced = sun_[r] | moon_[r];
+        if (forced) return Position{r, std::countr_zero(forced)};
+    }
+    return std::nullopt;
+}
+
+Cell ForcedMoves::value_at(int row, int col) const {
+    uint32_t bit = uint32_t{1} << col;
+    if (sun_[row] & bit) return Cell::Sun;
+    if (moon_[row] & bit) return Cell::Moon;
+    return Cell::Empty;
+}
+
+void ForcedMoves::refresh(const Puzzle& puzzle, int row, int col) {
+    uint32_t bit = uint32_t{1} << col;
+    if ((sun_[row] | moon_[row]) & bit) count_--;
+    sun_[row] &= ~bit;
+    moon_[row] &= ~bit;
+
+    if (!puzzle.grid().is_empty(row, col)) return;
+
+    bool sun = puzzle.is_valid_placement(row, col, Cell::Sun);
+    bool moon = puzzle.is_valid_placement(row, col, Cell::Moon);
+    if (sun == moon) return;
+
+    (sun ? sun_ : moon_)[row] |= bit;
+    count_++;
+}
+
+} // namespace eclipse
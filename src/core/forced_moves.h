@@ -0,0 +1,48 @@
+#pragma once
+
+#include "constraints.h"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace eclipse {
+
+// The cells a player can deduce right now: empty cells with exactly one
+// legal value, the same set Solver::get_forced_moves reports.
+// Kept up to date one change at a time instead of rescanning the board.
+// A change at (r, c) can only alter the legal values of cells in row r,
+// column c or the region of (r, c); clue partners are orthogonal
+// neighbours, so they are in the row or the column already.
+class ForcedMoves {
+public:
+    explicit ForcedMoves(const Puzzle& puzzle);
+
+    // Recompute everything, e.g. after the layout changed
+    void rebuild(const Puzzle& puzzle);
+
+    // Call after the cell at (row, col) changed
+    void update(const Puzzle& puzzle, int row, int col);
+
+    // Number of forced cells
+    int count() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    // First forced cell in row-major order
+    std::optional<Position> first() const;
+
+    // The value a cell is forced to, or Empty if it isn't forced
+    Cell value_at(int row, int col) const;
+
+    // Forced cells of a row, bit c for column c
+    uint32_t sun_bits(int row) const { return sun_[row]; }
+    uint32_t moon_bits(int row) const { return moon_[row]; }
+
+private:
+    std::vector<uint32_t> sun_;   // Bit c of row r: (r, c) can only be a Sun
+    std::vector<uint32_t> moon_;  // Bit c of row r: (r, c) can only be a Moon
+    int count_ = 0;
+
+    void refresh(const Puzzle& puzzle, int row, int col);
+};
+
+} // namespace eclipse
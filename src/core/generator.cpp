@@ -1,122 +1,236 @@
 #include "generator.h"
+#include "model_counter.h"
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <vector>
 
 namespace eclipse {
 
 Generator::Generator(const GeneratorConfig& config)
-    : config_(config), rng_(config.seed) {}
+    : config_(config),
+      rng_(config.seed),
+      arena_buffer_(kArenaBytes),
+      arena_(arena_buffer_.data(), arena_buffer_.size()),
+      count_solutions_(solution_counter_for_size(config.grid_size)) {}
 
 std::unique_ptr<Puzzle> Generator::generate() {
+    Puzzle::allocator_type alloc(&arena_);
+    
     // Try multiple times to generate a valid puzzle
     for (int attempt = 0; attempt < 100; ++attempt) {
-        auto puzzle = std::make_unique<Puzzle>(config_.grid_size);
+        // The previous attempt's puzzles are gone; reclaim their memory
+        arena_.release();
         
-        // Generate regions first
-        puzzle->regions().generate_random_regions(config_.num_regions, rng_());
+        Puzzle puzzle(config_.grid_size, alloc);
         
-        // Generate solved grid
-        if (!generate_solved_grid(*puzzle)) {
+        // Region layout and solved grid
+        if (!generate_layout_and_solution(puzzle)) {
             continue;
         }
         
-        // Create puzzle by removing cells
-        auto solution = std::make_unique<Puzzle>(config_.grid_size);
-        solution->grid() = puzzle->grid().clone();
-        solution->regions() = puzzle->regions();
-        
-        Puzzle puzzle_attempt(config_.grid_size);
-        puzzle_attempt.regions() = puzzle->regions();
+        // Create puzzle by removing cells; the attempt shares the layout
+        Puzzle puzzle_attempt(config_.grid_size, alloc);
+        puzzle_attempt.set_topology(puzzle.topology());
         
-        create_puzzle_from_solution(*puzzle, puzzle_attempt);
+        create_puzzle_from_solution(puzzle, puzzle_attempt);
         
         // Add relationship clues if enabled
         if (config_.use_relationship_clues) {
             int clue_count = 3 + (static_cast<int>(config_.difficulty) * 2);
-            add_relationship_clues(puzzle_attempt, clue_count);
+            add_relationship_clues(puzzle_attempt, puzzle, clue_count);
         }
         
         // Verify unique solution
         if (has_unique_solution(puzzle_attempt)) {
-            return std::make_unique<Puzzle>(puzzle_attempt);
+            return std::make_unique<Puzzle>(puzzle_attempt.clone());
         }
     }
     
     // Fallback: generate simpler puzzle
-    auto puzzle = std::make_unique<Puzzle>(config_.grid_size);
-    puzzle->regions().generate_random_regions(config_.num_regions, rng_());
-    generate_solved_grid(*puzzle);
+    arena_.release();
+    
+    Puzzle puzzle(config_.grid_size, alloc);
+    generate_layout_and_solution(puzzle);
     
     // Leave more clues for easier solving
-    Puzzle simple(config_.grid_size);
-    simple.regions() = puzzle->regions();
+    Puzzle simple(config_.grid_size, alloc);
+    simple.set_topology(puzzle.topology());
     
     // Copy half the cells as clues
     int cells_to_fill = (config_.grid_size * config_.grid_size) / 2;
-    std::vector<Position> all_cells;
+    std::pmr::vector<Position> all_cells(&arena_);
     for (int r = 0; r < config_.grid_size; ++r) {
         for (int c = 0; c < config_.grid_size; ++c) {
             all_cells.push_back({r, c});
         }
     }
-    std::shuffle(all_cells.begin(), all_cells.end(), rng_);
+    rng_.shuffle(all_cells.begin(), all_cells.end());
     
     for (int i = 0; i < cells_to_fill && i < static_cast<int>(all_cells.size()); ++i) {
         auto pos = all_cells[i];
-        simple.grid().set(pos.row, pos.col, puzzle->grid().get(pos.row, pos.col));
+        simple.grid().set(pos.row, pos.col, puzzle.grid().get(pos.row, pos.col));
     }
     
-    return std::make_unique<Puzzle>(simple);
+    return std::make_unique<Puzzle>(simple.clone());
 }
 
 bool Generator::generate_solved_grid(Puzzle& puzzle) {
     return fill_grid_random(puzzle);
 }
 
+bool Generator::generate_layout_and_solution(Puzzle& puzzle) {
+    if (config_.grid_size > kMaxRegionFirstSize) {
+        // Random layouts of large boards are almost never satisfiable, so
+        // fill the grid first and read each region's Suns off the solution
+        if (!generate_solved_grid(puzzle)) {
+            return false;
+        }
+        puzzle.mutable_regions().generate_random_regions(config_.num_regions, next_seed());
+        puzzle.mutable_regions().require_suns_of(puzzle.grid());
+        return true;
+    }
+    
+    // Generate regions first
+    puzzle.mutable_regions().generate_random_regions(config_.num_regions, next_seed());
+    
+    // Skip layouts with no solution before spending any search on them
+    if (!layout_has_solutions(puzzle)) {
+        return false;
+    }
+    
+    return generate_solved_grid(puzzle);
+}
+
 bool Generator::fill_grid_random(Puzzle& puzzle) {
-    // Find empty cell
-    auto empty_cells = puzzle.grid().get_empty_cells();
-    if (empty_cells.empty()) {
-        return true;  // Solved
+    int size = puzzle.size();
+    
+    // One level per filled cell, kept explicitly so large boards don't
+    // recurse once per cell
+    std::pmr::vector<FillLevel> stack(&arena_);
+    stack.reserve(static_cast<size_t>(size) * size);
+    
+    int64_t budget = int64_t{kFillNodesPerCell} * size * size;
+    
+    while (true) {
+        FillLevel level;
+        FillPick pick = pick_fill_cell(puzzle, level);
+        if (pick == FillPick::Solved) {
+            return true;
+        }
+        if (pick == FillPick::Chosen) {
+            stack.push_back(level);
+        }
+        
+        // Backtrack: undo levels with no value left to try
+        while (!stack.empty() && stack.back().next == stack.back().count) {
+            puzzle.grid().set(stack.back().pos.row, stack.back().pos.col, Cell::Empty);
+            stack.pop_back();
+        }
+        if (stack.empty()) {
+            return false;
+        }
+        
+        // Random fills have heavy-tailed run times on large boards; past the
+        // budget a fresh attempt is cheaper than finishing this one
+        if (--budget < 0) {
+            for (const FillLevel& open : stack) {
+                puzzle.grid().set(open.pos.row, open.pos.col, Cell::Empty);
+            }
+            return false;
+        }
+        
+        FillLevel& top = stack.back();
+        puzzle.grid().set(top.pos.row, top.pos.col, top.values[top.next++]);
+    }
+}
+
+Generator::FillPick Generator::pick_fill_cell(Puzzle& puzzle, FillLevel& level) {
+    // Legal values of every cell in one pass
+    puzzle.compute_candidates(candidates_);
+    
+    const Grid& grid = puzzle.grid();
+    int size = grid.size();
+    
+    // Pick a random cell among those with the fewest legal values
+    int min_choices = 3;
+    int ties = 0;
+    for (int r = 0; r < size; ++r) {
+        uint32_t empty = grid.empty_bits(r);
+        uint32_t sun = candidates_.sun[r];
+        uint32_t moon = candidates_.moon[r];
+        
+        if (empty & ~(sun | moon)) {
+            return FillPick::DeadEnd;
+        }
+        
+        uint32_t single = sun ^ moon;
+        if (single) {
+            if (min_choices > 1) {
+                min_choices = 1;
+                ties = 0;
+            }
+            ties += std::popcount(single);
+        } else if (min_choices == 2 || min_choices == 3) {
+            min_choices = 2;
+            ties += std::popcount(sun & moon);
+        }
+    }
+    
+    if (ties == 0) {
+        return FillPick::Solved;
     }
     
-    // Pick random empty cell
-    std::uniform_int_distribution<size_t> dist(0, empty_cells.size() - 1);
-    Position pos = empty_cells[dist(rng_)];
+    int pick = rng_.uniform(0, ties - 1);
+    
+    Position pos{-1, -1};
+    for (int r = 0; r < size && pos.row < 0; ++r) {
+        uint32_t sun = candidates_.sun[r];
+        uint32_t moon = candidates_.moon[r];
+        uint32_t cells = min_choices == 1 ? (sun ^ moon) : (sun & moon);
+        
+        int count = std::popcount(cells);
+        if (pick >= count) {
+            pick -= count;
+            continue;
+        }
+        
+        while (pick-- > 0) cells &= cells - 1;
+        pos = {r, std::countr_zero(cells)};
+    }
+    
+    uint32_t bit = uint32_t{1} << pos.col;
+    bool sun_legal = candidates_.sun[pos.row] & bit;
+    bool moon_legal = candidates_.moon[pos.row] & bit;
     
     // Try values in random order
-    std::vector<Cell> values = {Cell::Sun, Cell::Moon};
-    std::shuffle(values.begin(), values.end(), rng_);
+    std::array<Cell, 2> values = {Cell::Sun, Cell::Moon};
+    rng_.shuffle(values.begin(), values.end());
     
+    level.pos = pos;
+    level.count = 0;
+    level.next = 0;
     for (Cell value : values) {
-        if (puzzle.is_valid_placement(pos.row, pos.col, value)) {
-            puzzle.grid().set(pos.row, pos.col, value);
-            
-            if (fill_grid_random(puzzle)) {
-                return true;
-            }
-            
-            // Backtrack
-            puzzle.grid().set(pos.row, pos.col, Cell::Empty);
+        if (value == Cell::Sun ? sun_legal : moon_legal) {
+            level.values[level.count++] = value;
         }
     }
-    
-    return false;
+    return FillPick::Chosen;
 }
 
 void Generator::create_puzzle_from_solution(Puzzle& solution, Puzzle& puzzle) {
-    // Start with full solution
-    puzzle.grid() = solution.grid().clone();
+    // Start with full solution (copied into the puzzle's own storage)
+    puzzle.grid() = solution.grid();
     
     // Get all positions
-    std::vector<Position> positions;
+    std::pmr::vector<Position> positions(&arena_);
     for (int r = 0; r < config_.grid_size; ++r) {
         for (int c = 0; c < config_.grid_size; ++c) {
             positions.push_back({r, c});
         }
     }
     
-    std::shuffle(positions.begin(), positions.end(), rng_);
+    rng_.shuffle(positions.begin(), positions.end());
     
     int target_empty = config_.max_empty_cells;
     int removed = 0;
@@ -129,9 +243,7 @@ void Generator::create_puzzle_from_solution(Puzzle& solution, Puzzle& puzzle) {
         puzzle.grid().set(pos.row, pos.col, Cell::Empty);
         
         // Check if still unique solution
-        Puzzle test_puzzle = puzzle;
-        Solver solver(test_puzzle);
-        int solutions = solver.count_solutions(2);
+        int solutions = count_solutions_(puzzle, 2);
         
         if (solutions == 1) {
             // Good, keep it removed
@@ -143,63 +255,95 @@ void Generator::create_puzzle_from_solution(Puzzle& solution, Puzzle& puzzle) {
     }
 }
 
-void Generator::add_relationship_clues(Puzzle& puzzle, int count) {
-    std::vector<std::pair<Position, Position>> candidates;
+void Generator::add_relationship_clues(Puzzle& puzzle, const Puzzle& solution, int count) {
+    std::pmr::vector<Clue> candidates(&arena_);
     
-    // Find all adjacent pairs
+    // Every adjacent pair, with the relationship it has in the solution
+    const Grid& solved = solution.grid();
     for (int r = 0; r < config_.grid_size; ++r) {
         for (int c = 0; c < config_.grid_size; ++c) {
-            // Horizontal
-            if (c < config_.grid_size - 1) {
-                candidates.push_back({{r, c}, {r, c + 1}});
-            }
-            // Vertical
-            if (r < config_.grid_size - 1) {
-                candidates.push_back({{r, c}, {r + 1, c}});
+            for (Position other : {Position{r, c + 1}, Position{r + 1, c}}) {
+                if (!solved.in_bounds(other.row, other.col)) continue;
+                
+                bool equal = solved.get(r, c) == solved.get(other.row, other.col);
+                candidates.push_back({{r, c}, other,
+                                      equal ? RelationshipClue::Equal : RelationshipClue::NotEqual});
             }
         }
     }
     
-    std::shuffle(candidates.begin(), candidates.end(), rng_);
+    // Random order breaks ties between equally useful clues
+    rng_.shuffle(candidates.begin(), candidates.end());
     
-    int added = 0;
-    for (const auto& pair : candidates) {
-        if (added >= count) break;
-        
-        Cell val1 = puzzle.grid().get(pair.first.row, pair.first.col);
-        Cell val2 = puzzle.grid().get(pair.second.row, pair.second.col);
-        
-        // Only add clues where at least one cell is empty
-        if (val1 == Cell::Empty || val2 == Cell::Empty) {
-            // Determine clue type based on solution
-            RelationshipClue clue_type = RelationshipClue::NotEqual;
-            if (val1 != Cell::Empty && val2 != Cell::Empty) {
-                clue_type = (val1 == val2) ? RelationshipClue::Equal : RelationshipClue::NotEqual;
+    // What propagation alone deduces from the puzzle and the clues so far
+    Puzzle deduced(puzzle, &arena_);
+    Solver(deduced).propagate();
+    
+    // Trials live one at a time in a block of the arena, which is handed
+    // back after each; only a trial outgrowing it reaches into the arena
+    std::pmr::vector<std::byte> trial_block(kTrialBytes, &arena_);
+    std::pmr::monotonic_buffer_resource trials(trial_block.data(), trial_block.size(), &arena_);
+    
+    for (int added = 0; added < count; ++added) {
+        // Score each clue by the cells it lets propagation fill
+        int best = -1;
+        int best_gain = 0;
+        for (int i = 0; i < static_cast<int>(candidates.size()); ++i) {
+            const Clue& clue = candidates[i];
+            if (!deduced.grid().is_empty(clue.cell1.row, clue.cell1.col) &&
+                !deduced.grid().is_empty(clue.cell2.row, clue.cell2.col)) {
+                continue;  // Both cells already follow
             }
             
-            Clue clue;
-            clue.cell1 = pair.first;
-            clue.cell2 = pair.second;
-            clue.type = clue_type;
+            int gain = 0;
+            {
+                // Takes its own copy of the layout, which add_clue then
+                // extends in place
+                Puzzle trial(deduced, &trials);
+                trial.add_clue(clue);
+                Solver(trial).propagate();
+                gain = deduced.grid().empty_count() - trial.grid().empty_count();
+            }
+            trials.release();
             
-            puzzle.add_clue(clue);
-            added++;
+            if (gain > best_gain) {
+                best = i;
+                best_gain = gain;
+            }
         }
+        
+        // No clue left that unlocks a deduction
+        if (best < 0) break;
+        
+        Clue clue = candidates[best];
+        candidates.erase(candidates.begin() + best);
+        
+        puzzle.add_clue(clue);
+        deduced.add_clue(clue);
+        Solver(deduced).propagate();
     }
 }
 
 int Generator::evaluate_difficulty(const Puzzle& puzzle) const {
     // Count empty cells and analyze constraint tightness
-    int empty_count = static_cast<int>(puzzle.grid().get_empty_cells().size());
+    int empty_count = puzzle.grid().empty_count();
     
     // More empty cells = harder
     return empty_count * 10;
 }
 
+bool Generator::layout_has_solutions(const Puzzle& puzzle) const {
+    if (puzzle.size() > kMaxCountedLayoutSize ||
+        puzzle.regions().region_count() > ModelCounter::kMaxRegions) {
+        return true;  // Too large to count; let the search decide
+    }
+    
+    ModelCounter counter(puzzle);
+    return counter.count() > 0;
+}
+
 bool Generator::has_unique_solution(Puzzle& puzzle) const {
-    Puzzle test = puzzle;
-    Solver solver(test);
-    return solver.count_solutions(2) == 1;
+    return count_solutions_(puzzle, 2) == 1;
 }
 
 } // namespace eclipse
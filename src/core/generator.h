@@ -2,8 +2,14 @@
 
 #include "constraints.h"
 #include "solver.h"
-#include <random>
+#include "fixed_solver.h"
+#include "rng.h"
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
+#include <vector>
+#include <cstddef>
 
 namespace eclipse {
 
@@ -29,6 +35,9 @@ class Generator {
 public:
     explicit Generator(const GeneratorConfig& config);
     
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    
     // Generate a complete puzzle with unique solution
     std::unique_ptr<Puzzle> generate();
     
@@ -36,21 +45,81 @@ public:
     bool generate_solved_grid(Puzzle& puzzle);
     
 private:
+    // Initial arena block; an attempt that fits in it never touches the heap
+    static constexpr size_t kArenaBytes = 64 * 1024;
+    
+    // Scratch block for one clue trial (a copy of the puzzle with its
+    // layout, and the solver's buffers); 16x16 boards need about 9 KiB
+    static constexpr size_t kTrialBytes = 16 * 1024;
+    
+    // Largest board generated layout first, with every region asked for
+    // half its cells in Suns. Larger boards are filled first and their
+    // regions take their Sun counts from the solution.
+    static constexpr int kMaxRegionFirstSize = 8;
+    
+    // Largest layout checked by exact counting before filling. Past it the
+    // count costs more than the failed fills it saves.
+    static constexpr int kMaxCountedLayoutSize = 6;
+    
+    // Search nodes a random fill may spend per cell before the attempt is
+    // abandoned
+    static constexpr int kFillNodesPerCell = 8;
+    
     GeneratorConfig config_;
-    std::mt19937 rng_;
+    Rng rng_;
+    
+    // Everything one generation attempt allocates (puzzles, regions, scratch
+    // lists) comes from arena_ and is dropped in one release() when the
+    // next attempt starts. Only the finished puzzle is copied out.
+    std::vector<std::byte> arena_buffer_;
+    std::pmr::monotonic_buffer_resource arena_;
     
-    // Fill grid randomly while respecting constraints
+    CandidateMasks candidates_;  // Reused by every fill step
+    SolutionCounter count_solutions_;  // Specialised for config_.grid_size
+    
+    // One filled cell of the random fill and the values left to try there
+    struct FillLevel {
+        Position pos{-1, -1};
+        std::array<Cell, 2> values{};
+        int count = 0;
+        int next = 0;
+    };
+    
+    enum class FillPick {
+        Chosen,
+        Solved,
+        DeadEnd
+    };
+    
+    // Seed for a region layout, drawn from rng_
+    unsigned next_seed() { return static_cast<unsigned>(rng_.next() >> 32); }
+    
+    // Region layout and a solved grid for it, in the order the board size
+    // calls for
+    bool generate_layout_and_solution(Puzzle& puzzle);
+    
+    // Fill grid randomly while respecting constraints. Gives up, leaving the
+    // grid as it was, when the search runs over budget.
     bool fill_grid_random(Puzzle& puzzle);
     
+    // Choose the next cell to fill: a random one among those with the fewest
+    // legal values, with those values in random order
+    FillPick pick_fill_cell(Puzzle& puzzle, FillLevel& level);
+    
     // Remove cells to create puzzle (while maintaining uniqueness)
     void create_puzzle_from_solution(Puzzle& solution, Puzzle& puzzle);
     
-    // Add relationship clues between cells
-    void add_relationship_clues(Puzzle& puzzle, int count);
+    // Add up to count relationship clues that agree with the solution,
+    // greedily picking the one that lets propagation fill the most cells
+    // each time; stops early once no clue adds a deduction
+    void add_relationship_clues(Puzzle& puzzle, const Puzzle& solution, int count);
     
     // Evaluate puzzle difficulty
     int evaluate_difficulty(const Puzzle& puzzle) const;
     
+    // Check that a region layout admits at least one solution
+    bool layout_has_solutions(const Puzzle& puzzle) const;
+    
     // Check if puzzle has unique solution
     bool has_unique_solution(Puzzle& puzzle) const;
 };
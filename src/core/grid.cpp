@@ -1,12 +1,59 @@
 #include "grid.h"
 #include <stdexcept>
+#include <algorithm>
 
 namespace eclipse {
 
-Grid::Grid(int size) : size_(size), cells_(size * size, Cell::Empty) {
+Grid::Grid(int size, allocator_type alloc)
+    : size_(size),
+      cells_(size * size, Cell::Empty, alloc),
+      sun_rows_(size, 0, alloc),
+      moon_rows_(size, 0, alloc),
+      sun_cols_(size, 0, alloc),
+      moon_cols_(size, 0, alloc),
+      empty_count_(size * size) {
     if (size < 4 || size % 2 != 0) {
         throw std::invalid_argument("Grid size must be even and >= 4");
     }
+    if (size > kMaxSize) {
+        throw std::invalid_argument("Grid size must be <= 32");
+    }
+}
+
+Grid::Grid(const Grid& other, allocator_type alloc)
+    : size_(other.size_),
+      cells_(other.cells_, alloc),
+      sun_rows_(other.sun_rows_, alloc),
+      moon_rows_(other.moon_rows_, alloc),
+      sun_cols_(other.sun_cols_, alloc),
+      moon_cols_(other.moon_cols_, alloc),
+      empty_count_(other.empty_count_),
+      revision_(other.revision_) {}
+
+Grid& Grid::operator=(const Grid& other) {
+    uint64_t revision = std::max(revision_, other.revision_) + 1;
+    size_ = other.size_;
+    cells_ = other.cells_;
+    sun_rows_ = other.sun_rows_;
+    moon_rows_ = other.moon_rows_;
+    sun_cols_ = other.sun_cols_;
+    moon_cols_ = other.moon_cols_;
+    empty_count_ = other.empty_count_;
+    revision_ = revision;
+    return *this;
+}
+
+Grid& Grid::operator=(Grid&& other) {
+    uint64_t revision = std::max(revision_, other.revision_) + 1;
+    size_ = other.size_;
+    cells_ = std::move(other.cells_);
+    sun_rows_ = std::move(other.sun_rows_);
+    moon_rows_ = std::move(other.moon_rows_);
+    sun_cols_ = std::move(other.sun_cols_);
+    moon_cols_ = std::move(other.moon_cols_);
+    empty_count_ = other.empty_count_;
+    revision_ = revision;
+    return *this;
 }
 
 Cell Grid::get(int row, int col) const {
@@ -20,7 +67,29 @@ void Grid::set(int row, int col, Cell value) {
     if (!in_bounds(row, col)) {
         throw std::out_of_range("Grid access out of bounds");
     }
-    cells_[index(row, col)] = value;
+    Cell& cell = cells_[index(row, col)];
+    
+    if (cell == Cell::Empty) empty_count_--;
+    if (value == Cell::Empty) empty_count_++;
+    
+    if (cell == Cell::Sun) {
+        sun_rows_[row] &= ~(uint32_t{1} << col);
+        sun_cols_[col] &= ~(uint32_t{1} << row);
+    } else if (cell == Cell::Moon) {
+        moon_rows_[row] &= ~(uint32_t{1} << col);
+        moon_cols_[col] &= ~(uint32_t{1} << row);
+    }
+    
+    if (value == Cell::Sun) {
+        sun_rows_[row] |= uint32_t{1} << col;
+        sun_cols_[col] |= uint32_t{1} << row;
+    } else if (value == Cell::Moon) {
+        moon_rows_[row] |= uint32_t{1} << col;
+        moon_cols_[col] |= uint32_t{1} << row;
+    }
+    
+    cell = value;
+    revision_++;
 }
 
 bool Grid::is_empty(int row, int col) const {
@@ -32,45 +101,41 @@ bool Grid::in_bounds(int row, int col) const {
 }
 
 std::vector<Position> Grid::get_empty_cells() const {
+    EmptyCells cells = empty_cells();
     std::vector<Position> empty;
-    for (int r = 0; r < size_; ++r) {
-        for (int c = 0; c < size_; ++c) {
-            if (is_empty(r, c)) {
-                empty.push_back({r, c});
-            }
-        }
+    empty.reserve(cells.size());
+    for (Position pos : cells) {
+        empty.push_back(pos);
     }
     return empty;
 }
 
 Grid Grid::clone() const {
-    Grid copy(size_);
-    copy.cells_ = cells_;
-    return copy;
-}
-
-bool Grid::is_complete() const {
-    return get_empty_cells().empty();
+    return *this;
 }
 
-std::vector<Cell> Grid::get_row(int row) const {
-    std::vector<Cell> result(size_);
-    for (int c = 0; c < size_; ++c) {
-        result[c] = get(row, c);
+RowView Grid::get_row(int row) const {
+    if (row < 0 || row >= size_) {
+        throw std::out_of_range("Grid access out of bounds");
     }
-    return result;
+    return RowView(cells_.data() + index(row, 0), static_cast<size_t>(size_));
 }
 
-std::vector<Cell> Grid::get_col(int col) const {
-    std::vector<Cell> result(size_);
-    for (int r = 0; r < size_; ++r) {
-        result[r] = get(r, col);
+ColumnView Grid::get_col(int col) const {
+    if (col < 0 || col >= size_) {
+        throw std::out_of_range("Grid access out of bounds");
     }
-    return result;
+    return ColumnView(cells_.data() + col, size_);
 }
 
 void Grid::clear() {
     std::fill(cells_.begin(), cells_.end(), Cell::Empty);
+    std::fill(sun_rows_.begin(), sun_rows_.end(), 0);
+    std::fill(moon_rows_.begin(), moon_rows_.end(), 0);
+    std::fill(sun_cols_.begin(), sun_cols_.end(), 0);
+    std::fill(moon_cols_.begin(), moon_cols_.end(), 0);
+    empty_count_ = size_ * size_;
+    revision_++;
 }
 
 } // namespace eclipse
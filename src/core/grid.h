@@ -2,7 +2,12 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
+#include <bit>
+#include <iterator>
 #include <optional>
+#include <memory_resource>
+#include <span>
 
 namespace eclipse {
 
@@ -27,10 +32,122 @@ struct Position {
     }
 };
 
-// A grid represents the puzzle state
+// Non-owning view of one row; a row is contiguous in the grid
+using RowView = std::span<const Cell>;
+
+// Non-owning view of one column: every size-th cell of the grid
+class ColumnView {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = Cell;
+        using reference = const Cell&;
+        using pointer = const Cell*;
+
+        iterator() = default;
+        iterator(const Cell* first, std::ptrdiff_t stride, std::ptrdiff_t row)
+            : first_(first), stride_(stride), row_(row) {}
+
+        reference operator*() const { return first_[row_ * stride_]; }
+
+        iterator& operator++() { ++row_; return *this; }
+        iterator operator++(int) { iterator old = *this; ++row_; return old; }
+
+        // Counts rows rather than stepping a pointer: the cell below the
+        // last row of any column but the first lies past the grid's end
+        bool operator==(const iterator& other) const { return row_ == other.row_; }
+
+    private:
+        const Cell* first_ = nullptr;
+        std::ptrdiff_t stride_ = 1;
+        std::ptrdiff_t row_ = 0;
+    };
+
+    ColumnView(const Cell* first, int size) : first_(first), size_(size) {}
+
+    iterator begin() const { return {first_, size_, 0}; }
+    iterator end() const { return {first_, size_, size_}; }
+
+    size_t size() const { return static_cast<size_t>(size_); }
+    const Cell& operator[](size_t row) const { return first_[row * size_]; }
+
+private:
+    const Cell* first_;
+    int size_;
+};
+
+class Grid;
+
+// Empty cells in row-major order, read off the row masks; never allocates
+class EmptyCells {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = Position;
+        using reference = Position;
+        using pointer = void;
+
+        iterator() = default;
+        iterator(const Grid* grid, int row);
+
+        Position operator*() const { return {row_, std::countr_zero(bits_)}; }
+
+        iterator& operator++() {
+            bits_ &= bits_ - 1;
+            if (!bits_) next_row(row_ + 1);
+            return *this;
+        }
+        iterator operator++(int) { iterator old = *this; ++*this; return old; }
+
+        bool operator==(const iterator& other) const {
+            return row_ == other.row_ && bits_ == other.bits_;
+        }
+        bool operator==(std::default_sentinel_t) const { return bits_ == 0; }
+
+    private:
+        const Grid* grid_ = nullptr;
+        int row_ = 0;
+        uint32_t bits_ = 0;  // Empty cells of row_ not visited yet
+
+        void next_row(int row);
+    };
+
+    explicit EmptyCells(const Grid& grid) : grid_(&grid) {}
+
+    iterator begin() const { return {grid_, 0}; }
+    std::default_sentinel_t end() const { return {}; }
+
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+
+private:
+    const Grid* grid_;
+};
+
+// A grid represents the puzzle state.
+// Storage comes from a memory resource (the default heap unless given);
+// a plain copy always lands on the default resource, the allocator-extended
+// copy on the one passed in.
 class Grid {
 public:
-    explicit Grid(int size = 6);
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+    
+    // Rows and columns are also kept as bitmasks, one bit per cell
+    static constexpr int kMaxSize = 32;
+    
+    explicit Grid(int size = 6, allocator_type alloc = {});
+    
+    Grid(const Grid& other) = default;
+    Grid(Grid&& other) = default;
+    Grid(const Grid& other, allocator_type alloc);
+    Grid& operator=(const Grid& other);
+    Grid& operator=(Grid&& other);
+    
+    allocator_type get_allocator() const { return cells_.get_allocator(); }
 
     int size() const { return size_; }
     
@@ -40,28 +157,77 @@ public:
     bool is_empty(int row, int col) const;
     bool in_bounds(int row, int col) const;
     
-    // Get all empty cells
+    // Empty cells, in row-major order, without allocating
+    EmptyCells empty_cells() const { return EmptyCells(*this); }
+    int empty_count() const { return empty_count_; }
+    
+    // Get all empty cells as a list (allocates; prefer empty_cells())
     std::vector<Position> get_empty_cells() const;
     
     // Copy
     Grid clone() const;
     
-    // Check if grid is complete (no empty cells)
-    bool is_complete() const;
+    // Check if grid is complete (no empty cells); O(1)
+    bool is_complete() const { return empty_count_ == 0; }
     
-    // Get row/col as vectors
-    std::vector<Cell> get_row(int row) const;
-    std::vector<Cell> get_col(int col) const;
+    // Views of a row/column into the grid; valid while the grid lives
+    RowView get_row(int row) const;
+    ColumnView get_col(int col) const;
+    
+    // Bitmask of cells holding value (Sun or Moon); bit c of a row mask is
+    // column c, bit r of a column mask is row r
+    uint32_t row_bits(int row, Cell value) const {
+        return value == Cell::Sun ? sun_rows_[row] : moon_rows_[row];
+    }
+    uint32_t col_bits(int col, Cell value) const {
+        return value == Cell::Sun ? sun_cols_[col] : moon_cols_[col];
+    }
+    
+    // Empty cells of a row, bit c for column c
+    uint32_t empty_bits(int row) const {
+        return full_mask() & ~(sun_rows_[row] | moon_rows_[row]);
+    }
+    
+    // Mask with one bit per row/column position
+    uint32_t full_mask() const {
+        return size_ == 32 ? ~uint32_t{0} : (uint32_t{1} << size_) - 1;
+    }
     
     // Clear the grid
     void clear();
     
+    // Bumped by every change, including assignment; never repeats for one
+    // grid object, so caches over the grid can tell whether they are stale
+    uint64_t revision() const { return revision_; }
+    
 private:
     int size_;
-    std::vector<Cell> cells_;  // Flattened 2D array
+    std::pmr::vector<Cell> cells_;  // Flattened 2D array
+    std::pmr::vector<uint32_t> sun_rows_;
+    std::pmr::vector<uint32_t> moon_rows_;
+    std::pmr::vector<uint32_t> sun_cols_;
+    std::pmr::vector<uint32_t> moon_cols_;
+    int empty_count_;
+    uint64_t revision_ = 0;
     
     int index(int row, int col) const { return row * size_ + col; }
 };
 
+inline EmptyCells::iterator::iterator(const Grid* grid, int row) : grid_(grid) {
+    next_row(row);
+}
+
+inline void EmptyCells::iterator::next_row(int row) {
+    bits_ = 0;
+    for (row_ = row; row_ < grid_->size(); ++row_) {
+        bits_ = grid_->empty_bits(row_);
+        if (bits_) return;
+    }
+}
+
+inline size_t EmptyCells::size() const {
+    return static_cast<size_t>(grid_->empty_count());
+}
+
 } // namespace eclipse
 
@@ -0,0 +1,235 @@
+#include "model_counter.h"
+#include <bit>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+namespace eclipse {
+
+// The row patterns, masks and transitions below encode the rules of
+// StandardRules by hand
+static_assert(std::is_same_v<StandardRules,
+                             RuleSet<LineBalanceRule, NoThreeRule, RegionRule, ClueRule>>,
+              "ModelCounter must encode every rule of StandardRules");
+
+ModelCounter::ModelCounter(const Puzzle& puzzle)
+    : puzzle_(puzzle),
+      size_(puzzle.size()),
+      half_(puzzle.size() / 2),
+      num_regions_(puzzle.regions().region_count()) {
+    if (size_ > kMaxSize) {
+        throw std::invalid_argument("ModelCounter supports boards up to 16x16");
+    }
+    if (num_regions_ > kMaxRegions) {
+        throw std::invalid_argument("ModelCounter supports up to 20 regions");
+    }
+
+    build_patterns();
+    build_masks();
+}
+
+size_t ModelCounter::StateHash::operator()(const State& state) const {
+    uint64_t hash = 0x9e3779b97f4a7c15ull;
+    for (uint64_t word : state.words) {
+        hash ^= word + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    }
+    return static_cast<size_t>(hash);
+}
+
+uint32_t ModelCounter::get_field(const State& state, int offset, int bits) {
+    return static_cast<uint32_t>(state.words[offset / 64] >> (offset % 64)) & ((1u << bits) - 1);
+}
+
+void ModelCounter::set_field(State& state, int offset, int bits, uint32_t value) {
+    uint64_t mask = ((uint64_t{1} << bits) - 1) << (offset % 64);
+    uint64_t& word = state.words[offset / 64];
+    word = (word & ~mask) | (static_cast<uint64_t>(value) << (offset % 64));
+}
+
+void ModelCounter::build_patterns() {
+    uint32_t full = (1u << size_) - 1;
+
+    for (uint32_t mask = 0; mask <= full; ++mask) {
+        if (std::popcount(mask) != half_) continue;
+
+        // Three equal neighbours show up as three adjacent set bits in
+        // either the Sun mask or its complement
+        uint32_t moons = ~mask & full;
+        if (mask & (mask >> 1) & (mask >> 2)) continue;
+        if (moons & (moons >> 1) & (moons >> 2)) continue;
+
+        patterns_.push_back(mask);
+    }
+}
+
+void ModelCounter::build_masks() {
+    const Grid& grid = puzzle_.grid();
+    const RegionManager& regions = puzzle_.regions();
+
+    given_suns_.assign(size_, 0);
+    given_moons_.assign(size_, 0);
+    equal_right_.assign(size_, 0);
+    not_equal_right_.assign(size_, 0);
+    equal_down_.assign(size_, 0);
+    not_equal_down_.assign(size_, 0);
+
+    for (int r = 0; r < size_; ++r) {
+        for (int c = 0; c < size_; ++c) {
+            Cell value = grid.get(r, c);
+            if (value == Cell::Sun) given_suns_[r] |= 1u << c;
+            else if (value == Cell::Moon) given_moons_[r] |= 1u << c;
+        }
+    }
+
+    // Only orthogonally adjacent clues constrain a placement
+    for (const auto& clue : puzzle_.get_clues()) {
+        Position a = clue.cell1;
+        Position b = clue.cell2;
+        if (b.row < a.row || (b.row == a.row && b.col < a.col)) std::swap(a, b);
+        if (!grid.in_bounds(a.row, a.col) || !grid.in_bounds(b.row, b.col)) continue;
+
+        // Puzzle::get_clue honours the first clue given for a pair
+        RelationshipClue type = puzzle_.get_clue(a, b);
+        bool equal = type == RelationshipClue::Equal;
+        bool not_equal = type == RelationshipClue::NotEqual;
+
+        if (a.row == b.row && b.col == a.col + 1) {
+            if (equal) equal_right_[a.row] |= 1u << a.col;
+            if (not_equal) not_equal_right_[a.row] |= 1u << a.col;
+        } else if (a.col == b.col && b.row == a.row + 1) {
+            if (equal) equal_down_[a.row] |= 1u << a.col;
+            if (not_equal) not_equal_down_[a.row] |= 1u << a.col;
+        }
+    }
+
+    region_rows_.assign(static_cast<size_t>(num_regions_) * size_, 0);
+    region_required_.assign(num_regions_, 0);
+    region_last_row_.assign(num_regions_, -1);
+    region_cells_below_.assign(static_cast<size_t>(num_regions_) * size_, 0);
+
+    for (int i = 0; i < num_regions_; ++i) {
+        region_required_[i] = regions.region_at(i).required_suns;
+
+        int row = regions.first_row(i);
+        for (uint32_t mask : regions.row_masks(i)) {
+            region_rows_[i * size_ + row] = mask;
+            if (mask) region_last_row_[i] = row;
+            row++;
+        }
+    }
+
+    for (int i = 0; i < num_regions_; ++i) {
+        int below = 0;
+        for (int r = size_ - 1; r >= 0; --r) {
+            region_cells_below_[i * size_ + r] = below;
+            below += std::popcount(region_rows_[i * size_ + r]);
+        }
+    }
+}
+
+uint64_t ModelCounter::count() {
+    saturated_ = false;
+
+    // A region with no cells can only hold zero Suns
+    for (int i = 0; i < num_regions_; ++i) {
+        if (region_last_row_[i] == -1 && region_required_[i] != 0) return 0;
+    }
+
+    uint32_t full = (1u << size_) - 1;
+    std::unordered_map<State, uint64_t, StateHash> current;
+    std::unordered_map<State, uint64_t, StateHash> next;
+    current.emplace(State{}, 1);
+
+    std::vector<uint32_t> row_patterns;
+    row_patterns.reserve(patterns_.size());
+
+    for (int r = 0; r < size_; ++r) {
+        // Patterns that agree with this row's givens and horizontal clues
+        row_patterns.clear();
+        for (uint32_t mask : patterns_) {
+            if ((mask & given_moons_[r]) || (given_suns_[r] & ~mask)) continue;
+
+            uint32_t differs = (mask ^ (mask >> 1)) & (full >> 1);
+            if (differs & equal_right_[r]) continue;
+            if (~differs & not_equal_right_[r]) continue;
+
+            row_patterns.push_back(mask);
+        }
+
+        int rows_left = size_ - 1 - r;
+        next.clear();
+
+        for (const auto& [state, ways] : current) {
+            uint32_t prev = get_field(state, 0, 16);
+            uint32_t prev2 = get_field(state, 16, 16);
+
+            for (uint32_t mask : row_patterns) {
+                if (r >= 1) {
+                    uint32_t differs = mask ^ prev;
+                    if (differs & equal_down_[r - 1]) continue;
+                    if (~differs & not_equal_down_[r - 1]) continue;
+                }
+                if (r >= 2) {
+                    if (mask & prev & prev2) continue;
+                    if (~mask & ~prev & ~prev2 & full) continue;
+                }
+
+                State out = state;
+                set_field(out, 0, 16, mask);
+                set_field(out, 16, 16, prev);
+
+                bool feasible = true;
+                for (int c = 0; c < size_ && feasible; ++c) {
+                    int suns = static_cast<int>(get_field(state, column_offset(c), 4)) +
+                               static_cast<int>((mask >> c) & 1u);
+                    if (suns > half_ || suns + rows_left < half_) feasible = false;
+                    set_field(out, column_offset(c), 4, static_cast<uint32_t>(suns));
+                }
+
+                for (int i = 0; i < num_regions_ && feasible; ++i) {
+                    if (r > region_last_row_[i]) continue;
+
+                    uint32_t cells = region_rows_[i * size_ + r];
+                    int suns = static_cast<int>(get_field(state, region_offset(i), 8)) +
+                               std::popcount(mask & cells);
+                    int required = region_required_[i];
+
+                    if (suns > required || suns + region_cells_below_[i * size_ + r] < required) {
+                        feasible = false;
+                    } else if (region_last_row_[i] == r) {
+                        // Closed regions are settled and dropped from the state
+                        set_field(out, region_offset(i), 8, 0);
+                    } else {
+                        set_field(out, region_offset(i), 8, static_cast<uint32_t>(suns));
+                    }
+                }
+
+                if (!feasible) continue;
+
+                uint64_t& total = next[out];
+                if (total > std::numeric_limits<uint64_t>::max() - ways) {
+                    total = std::numeric_limits<uint64_t>::max();
+                    saturated_ = true;
+                } else {
+                    total += ways;
+                }
+            }
+        }
+
+        current.swap(next);
+        if (current.empty()) return 0;
+    }
+
+    uint64_t total = 0;
+    for (const auto& [state, ways] : current) {
+        if (total > std::numeric_limits<uint64_t>::max() - ways) {
+            saturated_ = true;
+            return std::numeric_limits<uint64_t>::max();
+        }
+        total += ways;
+    }
+    return total;
+}
+
+} // namespace eclipse
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "constraints.h"
+#include <cstdint>
+#include <vector>
+
+namespace eclipse {
+
+// Exact solution counting by dynamic programming over rows.
+// Rows are swept top to bottom; the state between rows is the last two row
+// patterns, the Sun count of every column and the running Sun count of every
+// region still open at that row. Unlike Solver::count_solutions this never
+// enumerates solutions, so empty and sparse boards are cheap to count.
+class ModelCounter {
+public:
+    static constexpr int kMaxSize = 16;
+    static constexpr int kMaxRegions = 20;
+
+    // Throws std::invalid_argument for boards or layouts beyond the limits
+    explicit ModelCounter(const Puzzle& puzzle);
+
+    // Number of complete grids that extend the current one and satisfy every
+    // constraint. Saturates at UINT64_MAX; see saturated().
+    uint64_t count();
+
+    // True if the last count overflowed 64 bits
+    bool saturated() const { return saturated_; }
+
+private:
+    // Packed DP state: two row patterns, column counts and region counts
+    struct State {
+        uint64_t words[4] = {0, 0, 0, 0};
+
+        bool operator==(const State& other) const {
+            return words[0] == other.words[0] && words[1] == other.words[1] &&
+                   words[2] == other.words[2] && words[3] == other.words[3];
+        }
+    };
+
+    struct StateHash {
+        size_t operator()(const State& state) const;
+    };
+
+    const Puzzle& puzzle_;
+    int size_;
+    int half_;
+    int num_regions_;
+    bool saturated_ = false;
+
+    // Row patterns with N/2 Suns and no three equal neighbours
+    std::vector<uint32_t> patterns_;
+
+    // Per-row data, bit c refers to column c
+    std::vector<uint32_t> given_suns_;
+    std::vector<uint32_t> given_moons_;
+    std::vector<uint32_t> equal_right_;     // Clue between (r, c) and (r, c + 1)
+    std::vector<uint32_t> not_equal_right_;
+    std::vector<uint32_t> equal_down_;      // Clue between (r, c) and (r + 1, c)
+    std::vector<uint32_t> not_equal_down_;
+
+    // Region data, indexed [region * size_ + row]
+    std::vector<uint32_t> region_rows_;
+    std::vector<int> region_required_;
+    std::vector<int> region_last_row_;
+    std::vector<int> region_cells_below_;   // Cells in rows after [region * size_ + row]
+
+    void build_patterns();
+    void build_masks();
+
+    static uint32_t get_field(const State& state, int offset, int bits);
+    static void set_field(State& state, int offset, int bits, uint32_t value);
+
+    int column_offset(int col) const { return 32 + col * 4; }
+    int region_offset(int region) const { return 96 + region * 8; }
+};
+
+} // namespace eclipse
@@ -0,0 +1,234 @@
+#include "move_log.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace eclipse {
+
+namespace {
+
+constexpr uint8_t kMagic[3] = {'E', 'M', 'L'};
+constexpr uint8_t kVersion = 1;
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Reads from data at pos, bounds-checked; the log may come from disk
+class Reader {
+public:
+    explicit Reader(std::span<const uint8_t> data) : data_(data) {}
+
+    uint8_t byte() {
+        if (pos_ >= data_.size()) throw std::invalid_argument("Move log is truncated");
+        return data_[pos_++];
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            value |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return value;
+        }
+        throw std::invalid_argument("Move log has an overlong number");
+    }
+
+    std::span<const uint8_t> bytes(size_t count) {
+        if (data_.size() - pos_ < count) throw std::invalid_argument("Move log is truncated");
+        auto result = data_.subspan(pos_, count);
+        pos_ += count;
+        return result;
+    }
+
+    bool done() const { return pos_ == data_.size(); }
+
+private:
+    std::span<const uint8_t> data_;
+    size_t pos_ = 0;
+};
+
+} // namespace
+
+MoveLog::MoveLog(const Grid& start) : size_(start.size()) {
+    snapshots_.resize(board_bytes());
+    store(start, snapshots_.data());
+}
+
+void MoveLog::record(const Move& move, uint32_t delta_ms) {
+    // Undone moves and the snapshots taken after them no longer apply
+    moves_.resize(cursor_);
+    deltas_.resize(cursor_);
+    snapshots_.resize((cursor_ / kSnapshotInterval + 1) * board_bytes());
+
+    moves_.push_back(pack(move));
+    deltas_.push_back(delta_ms);
+    ++cursor_;
+    snapshot_if_due();
+}
+
+Move MoveLog::undo() {
+    if (!can_undo()) throw std::out_of_range("No move to undo");
+    return at(--cursor_);
+}
+
+Move MoveLog::redo() {
+    if (!can_redo()) throw std::out_of_range("No move to redo");
+    return at(cursor_++);
+}
+
+Move MoveLog::at(size_t index) const {
+    if (index >= moves_.size()) throw std::out_of_range("Move index past the end of the log");
+    return unpack(moves_[index]);
+}
+
+uint32_t MoveLog::delta_ms(size_t index) const {
+    if (index >= deltas_.size()) throw std::out_of_range("Move index past the end of the log");
+    return deltas_[index];
+}
+
+Grid MoveLog::board_at(size_t count) const {
+    if (count > moves_.size()) throw std::out_of_range("Move count past the end of the log");
+
+    size_t snapshot = count / kSnapshotInterval;
+    Grid grid(size_);
+    load(snapshots_.data() + snapshot * board_bytes(), grid);
+
+    for (size_t i = snapshot * kSnapshotInterval; i < count; ++i) {
+        Move move = at(i);
+        grid.set(move.position.row, move.position.col, move.new_value);
+    }
+    return grid;
+}
+
+Grid MoveLog::seek(size_t count) {
+    Grid grid = board_at(count);
+    cursor_ = count;
+    return grid;
+}
+
+std::vector<uint8_t> MoveLog::serialize() const {
+    std::vector<uint8_t> out(std::begin(kMagic), std::end(kMagic));
+    out.push_back(kVersion);
+    out.push_back(static_cast<uint8_t>(size_));
+    put_varint(out, moves_.size());
+    put_varint(out, cursor_);
+    out.insert(out.end(), snapshots_.begin(), snapshots_.begin() + board_bytes());
+
+    for (size_t i = 0; i < moves_.size(); ++i) {
+        out.push_back(static_cast<uint8_t>(moves_[i]));
+        out.push_back(static_cast<uint8_t>(moves_[i] >> 8));
+        put_varint(out, deltas_[i]);
+    }
+    return out;
+}
+
+MoveLog MoveLog::deserialize(std::span<const uint8_t> data) {
+    Reader reader(data);
+    for (uint8_t expected : kMagic) {
+        if (reader.byte() != expected) throw std::invalid_argument("Not a move log");
+    }
+    if (reader.byte() != kVersion) throw std::invalid_argument("Unsupported move log version");
+
+    Grid board(reader.byte());
+    uint64_t count = reader.varint();
+    uint64_t cursor = reader.varint();
+    if (cursor > count) throw std::invalid_argument("Move log cursor is past the end");
+
+    MoveLog log(board);
+    log.load(reader.bytes(log.board_bytes()).data(), board);
+    log.store(board, log.snapshots_.data());
+
+    // Each move is at least three bytes; don't trust count further than that
+    log.moves_.reserve(std::min<uint64_t>(count, data.size() / 3));
+    log.deltas_.reserve(log.moves_.capacity());
+
+    int cells = log.size_ * log.size_;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint16_t packed = reader.byte();
+        packed |= static_cast<uint16_t>(reader.byte() << 8);
+        uint64_t delta = reader.varint();
+
+        if ((packed >> 4) >= cells || (packed & 3) == 3 || ((packed >> 2) & 3) == 3 ||
+            delta > UINT32_MAX) {
+            throw std::invalid_argument("Move log has a malformed move");
+        }
+
+        // Replaying checks the log is consistent with itself and rebuilds
+        // the snapshots on the way
+        Move move = log.unpack(packed);
+        if (board.get(move.position.row, move.position.col) != move.old_value) {
+            throw std::invalid_argument("Move log does not replay");
+        }
+        board.set(move.position.row, move.position.col, move.new_value);
+
+        log.moves_.push_back(packed);
+        log.deltas_.push_back(static_cast<uint32_t>(delta));
+        if ((i + 1) % kSnapshotInterval == 0) {
+            size_t offset = log.snapshots_.size();
+            log.snapshots_.resize(offset + log.board_bytes());
+            log.store(board, log.snapshots_.data() + offset);
+        }
+    }
+    if (!reader.done()) throw std::invalid_argument("Move log has trailing data");
+
+    log.cursor_ = cursor;
+    return log;
+}
+
+uint16_t MoveLog::pack(const Move& move) const {
+    int index = move.position.row * size_ + move.position.col;
+    return static_cast<uint16_t>(index << 4 |
+                                 static_cast<int>(move.old_value) << 2 |
+                                 static_cast<int>(move.new_value));
+}
+
+Move MoveLog::unpack(uint16_t packed) const {
+    int index = packed >> 4;
+    return {{index / size_, index % size_},
+            static_cast<Cell>((packed >> 2) & 3),
+            static_cast<Cell>(packed & 3)};
+}
+
+void MoveLog::store(const Grid& grid, uint8_t* out) const {
+    std::fill(out, out + board_bytes(), uint8_t{0});
+    for (int r = 0; r < size_; ++r) {
+        for (int c = 0; c < size_; ++c) {
+            int i = r * size_ + c;
+            out[i / 4] |= static_cast<uint8_t>(static_cast<int>(grid.get(r, c)) << (i % 4 * 2));
+        }
+    }
+}
+
+void MoveLog::load(const uint8_t* in, Grid& grid) const {
+    for (int r = 0; r < size_; ++r) {
+        for (int c = 0; c < size_; ++c) {
+            int i = r * size_ + c;
+            int value = (in[i / 4] >> (i % 4 * 2)) & 3;
+            if (value == 3) throw std::invalid_argument("Move log has a malformed board");
+            grid.set(r, c, static_cast<Cell>(value));
+        }
+    }
+}
+
+void MoveLog::snapshot_if_due() {
+    if (moves_.size() % kSnapshotInterval != 0) return;
+
+    // Replay the interval onto the snapshot before it: amortised, one
+    // move's work per move
+    Grid board(size_);
+    size_t offset = snapshots_.size();
+    load(snapshots_.data() + offset - board_bytes(), board);
+    for (size_t i = moves_.size() - kSnapshotInterval; i < moves_.size(); ++i) {
+        Move move = at(i);
+        board.set(move.position.row, move.position.col, move.new_value);
+    }
+
+    snapshots_.resize(offset + board_bytes());
+    store(board, snapshots_.data() + offset);
+}
+
+} // namespace eclipse
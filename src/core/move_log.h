@@ -0,0 +1,89 @@
+#pragma once
+
+#include "grid.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace eclipse {
+
+struct Move {
+    Position position;
+    Cell old_value;
+    Cell new_value;
+};
+
+// The moves of one game, packed so thousands of games fit in little memory:
+// two bytes per move (cell index, old and new value) plus the time since
+// the previous move. A cursor splits the log into moves applied and moves
+// undone, so the log doubles as the undo/redo history.
+// The board is stored, two bits a cell, after every kSnapshotInterval
+// moves; the board at any point is the nearest snapshot before it plus
+// fewer than kSnapshotInterval replayed moves.
+class MoveLog {
+public:
+    static constexpr size_t kSnapshotInterval = 64;
+
+    // Log for a game starting from start, givens included
+    explicit MoveLog(const Grid& start);
+
+    int board_size() const { return size_; }
+
+    // Add a move at the cursor, dropping any undone moves past it.
+    // delta_ms is the time since the previous move.
+    void record(const Move& move, uint32_t delta_ms = 0);
+
+    // Moves in the log, and moves applied
+    size_t size() const { return moves_.size(); }
+    size_t cursor() const { return cursor_; }
+
+    bool can_undo() const { return cursor_ > 0; }
+    bool can_redo() const { return cursor_ < moves_.size(); }
+
+    // Step the cursor back or forward over one move and return that move.
+    // Throw std::out_of_range if there is none.
+    Move undo();
+    Move redo();
+
+    // Throw std::out_of_range for index >= size()
+    Move at(size_t index) const;
+    uint32_t delta_ms(size_t index) const;
+
+    // Board after the first count moves; throws std::out_of_range for
+    // count > size()
+    Grid board_at(size_t count) const;
+
+    // Move the cursor to count and return the board there; throws
+    // std::out_of_range, leaving the cursor alone, for count > size()
+    Grid seek(size_t count);
+
+    // Binary form: a header, the starting board, then each move as its two
+    // packed bytes and a varint time delta. The cursor is kept, so a game
+    // can be resumed where it stopped.
+    std::vector<uint8_t> serialize() const;
+
+    // Throws std::invalid_argument if data isn't a well-formed log, including
+    // a move whose old value doesn't match the board it was made on
+    static MoveLog deserialize(std::span<const uint8_t> data);
+
+private:
+    int size_;
+    size_t cursor_ = 0;
+    std::vector<uint16_t> moves_;      // Cell index << 4 | old << 2 | new
+    std::vector<uint32_t> deltas_;     // Milliseconds since the previous move
+    std::vector<uint8_t> snapshots_;   // Board after every kSnapshotInterval-th move
+
+    size_t board_bytes() const { return (static_cast<size_t>(size_) * size_ + 3) / 4; }
+
+    uint16_t pack(const Move& move) const;
+    Move unpack(uint16_t packed) const;
+
+    void store(const Grid& grid, uint8_t* out) const;
+    void load(const uint8_t* in, Grid& grid) const;
+
+    // Store the board after every move that completes an interval
+    void snapshot_if_due();
+};
+
+} // namespace eclipse
@@ -1,21 +1,51 @@
 #include "region.h"
-#include <random>
-#include <queue>
+#include "rng.h"
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <stdexcept>
 
 namespace eclipse {
 
-RegionManager::RegionManager(int grid_size)
-    : grid_size_(grid_size), cell_to_region_(grid_size * grid_size, -1) {}
+RegionManager::RegionManager(int grid_size, allocator_type alloc)
+    : grid_size_(grid_size),
+      cell_to_region_(grid_size * grid_size, -1, alloc),
+      cell_to_index_(grid_size * grid_size, -1, alloc),
+      id_to_index_(alloc),
+      ids_(alloc),
+      colors_(alloc),
+      required_(alloc),
+      first_row_(alloc),
+      cells_(alloc),
+      cell_offsets_(1, 0, alloc),
+      row_masks_(alloc),
+      mask_offsets_(1, 0, alloc) {}
+
+RegionManager::RegionManager(const RegionManager& other, allocator_type alloc)
+    : grid_size_(other.grid_size_),
+      cell_to_region_(other.cell_to_region_, alloc),
+      cell_to_index_(other.cell_to_index_, alloc),
+      id_to_index_(other.id_to_index_, alloc),
+      ids_(other.ids_, alloc),
+      colors_(other.colors_, alloc),
+      required_(other.required_, alloc),
+      first_row_(other.first_row_, alloc),
+      cells_(other.cells_, alloc),
+      cell_offsets_(other.cell_offsets_, alloc),
+      row_masks_(other.row_masks_, alloc),
+      mask_offsets_(other.mask_offsets_, alloc) {}
 
 void RegionManager::generate_random_regions(int num_regions, unsigned seed) {
     clear();
     
-    std::mt19937 rng(seed);
-    std::uniform_int_distribution<int> coord_dist(0, grid_size_ - 1);
+    // Scratch space comes from the same resource as the regions themselves
+    allocator_type alloc = get_allocator();
+    
+    Rng rng(seed);
     
     // Create color palette
-    std::vector<uint32_t> colors;
+    std::pmr::vector<uint32_t> colors(alloc);
     for (int i = 0; i < num_regions; ++i) {
         // Generate distinct colors
         float hue = (i * 360.0f / num_regions);
@@ -41,58 +71,52 @@ void RegionManager::generate_random_regions(int num_regions, unsigned seed) {
     }
     
     // Pick random starting seeds for BFS
-    std::vector<Position> seeds;
+    std::pmr::vector<std::pmr::vector<Position>> regions(alloc);
+    std::pmr::vector<Position> seeds(alloc);
     for (int i = 0; i < num_regions; ++i) {
         int attempts = 0;
         while (attempts++ < 100) {
-            int r = coord_dist(rng);
-            int c = coord_dist(rng);
+            int r = rng.uniform(0, grid_size_ - 1);
+            int c = rng.uniform(0, grid_size_ - 1);
             if (cell_to_region_[index(r, c)] == -1) {
                 seeds.push_back({r, c});
-                regions_.emplace_back(i, colors[i]);
+                regions.emplace_back();
                 cell_to_region_[index(r, c)] = i;
-                regions_[i].cells.push_back({r, c});
+                regions[i].push_back({r, c});
                 break;
             }
         }
     }
     
-    // BFS to grow regions
-    std::vector<std::queue<Position>> queues(num_regions);
-    for (int i = 0; i < num_regions; ++i) {
-        queues[i].push(seeds[i]);
-    }
-    
-    std::uniform_int_distribution<int> region_dist(0, num_regions - 1);
+    // BFS to grow regions. A region's cells are appended in BFS order, so
+    // its cell list doubles as its queue, read from queue_heads[i] on.
+    int placed = static_cast<int>(regions.size());
+    std::pmr::vector<size_t> queue_heads(placed, 0, alloc);
+    std::pmr::vector<int> active_regions(alloc);
     
     while (true) {
         // Pick a random region to grow
-        std::vector<int> active_regions;
-        for (int i = 0; i < num_regions; ++i) {
-            if (!queues[i].empty()) {
+        active_regions.clear();
+        for (int i = 0; i < placed; ++i) {
+            if (queue_heads[i] < regions[i].size()) {
                 active_regions.push_back(i);
             }
         }
         
         if (active_regions.empty()) break;
         
-        int region_id = active_regions[region_dist(rng) % active_regions.size()];
-        auto& queue = queues[region_id];
-        
-        if (queue.empty()) continue;
-        
-        Position current = queue.front();
-        queue.pop();
+        int region_id = active_regions[rng.below(static_cast<uint32_t>(active_regions.size()))];
+        Position current = regions[region_id][queue_heads[region_id]++];
         
         // Try to expand to neighbors
-        std::vector<Position> neighbors = {
+        std::array<Position, 4> neighbors = {{
             {current.row - 1, current.col},
             {current.row + 1, current.col},
             {current.row, current.col - 1},
             {current.row, current.col + 1}
-        };
+        }};
         
-        std::shuffle(neighbors.begin(), neighbors.end(), rng);
+        rng.shuffle(neighbors.begin(), neighbors.end());
         
         for (const auto& neighbor : neighbors) {
             if (neighbor.row >= 0 && neighbor.row < grid_size_ &&
@@ -100,24 +124,78 @@ void RegionManager::generate_random_regions(int num_regions, unsigned seed) {
                 int idx = index(neighbor.row, neighbor.col);
                 if (cell_to_region_[idx] == -1) {
                     cell_to_region_[idx] = region_id;
-                    regions_[region_id].cells.push_back(neighbor);
-                    queue.push(neighbor);
+                    regions[region_id].push_back(neighbor);
                 }
             }
         }
     }
     
-    // Calculate required suns for each region (half of region size)
-    for (auto& region : regions_) {
-        region.required_suns = static_cast<int>(region.cells.size()) / 2;
+    // Calculate required suns for each region (half of region size).
+    // Odd regions are rounded down and up in turn so the requirements add up
+    // to the size*size/2 suns every solution has; always rounding down makes
+    // almost every layout unsolvable.
+    // The BFS already claimed the cells, so they are laid out directly.
+    bool round_up = false;
+    for (int i = 0; i < placed; ++i) {
+        int cells = static_cast<int>(regions[i].size());
+        int required_suns = cells / 2;
+        if (cells % 2 != 0) {
+            if (round_up) required_suns++;
+            round_up = !round_up;
+        }
+        append_region(i, colors[i], required_suns, regions[i]);
     }
 }
 
 void RegionManager::add_region(const Region& region) {
-    regions_.push_back(region);
-    for (const auto& pos : region.cells) {
+    if (region.id < 0 || get_region_index(region.id) != -1) {
+        throw std::invalid_argument("Region id must be non-negative and unique");
+    }
+    for (size_t i = 0; i < region.cells.size(); ++i) {
+        const Position& pos = region.cells[i];
+        if (pos.row < 0 || pos.row >= grid_size_ || pos.col < 0 || pos.col >= grid_size_ ||
+            cell_to_region_[index(pos.row, pos.col)] != -1) {
+            // Release the cells claimed so far
+            for (size_t j = 0; j < i; ++j) {
+                cell_to_region_[index(region.cells[j].row, region.cells[j].col)] = -1;
+            }
+            throw std::invalid_argument("Region cell is out of bounds or already assigned");
+        }
         cell_to_region_[index(pos.row, pos.col)] = region.id;
     }
+    append_region(region.id, region.color, region.required_suns, region.cells);
+}
+
+void RegionManager::append_region(int id, uint32_t color, int required_suns,
+                                  std::span<const Position> cells) {
+    int dense = region_count();
+    
+    if (id >= static_cast<int>(id_to_index_.size())) {
+        id_to_index_.resize(id + 1, -1);
+    }
+    id_to_index_[id] = dense;
+    ids_.push_back(id);
+    colors_.push_back(color);
+    required_.push_back(required_suns);
+    
+    int first = grid_size_;
+    int last = -1;
+    for (const auto& pos : cells) {
+        cells_.push_back(static_cast<uint16_t>(index(pos.row, pos.col)));
+        cell_to_index_[index(pos.row, pos.col)] = dense;
+        first = std::min(first, pos.row);
+        last = std::max(last, pos.row);
+    }
+    cell_offsets_.push_back(static_cast<uint32_t>(cells_.size()));
+    
+    // One mask per row the region spans
+    first_row_.push_back(last == -1 ? 0 : first);
+    size_t base = row_masks_.size();
+    if (last != -1) row_masks_.resize(base + (last - first + 1), 0);
+    for (const auto& pos : cells) {
+        row_masks_[base + (pos.row - first)] |= uint32_t{1} << pos.col;
+    }
+    mask_offsets_.push_back(static_cast<uint32_t>(row_masks_.size()));
 }
 
 int RegionManager::get_region_id(int row, int col) const {
@@ -127,18 +205,59 @@ int RegionManager::get_region_id(int row, int col) const {
     return cell_to_region_[index(row, col)];
 }
 
-const Region* RegionManager::get_region(int region_id) const {
-    for (const auto& region : regions_) {
-        if (region.id == region_id) {
-            return &region;
-        }
+std::optional<RegionView> RegionManager::get_region(int region_id) const {
+    int dense = get_region_index(region_id);
+    if (dense == -1) return std::nullopt;
+    return region_at(dense);
+}
+
+int RegionManager::get_region_index(int region_id) const {
+    if (region_id < 0 || region_id >= static_cast<int>(id_to_index_.size())) {
+        return -1;
+    }
+    return id_to_index_[region_id];
+}
+
+int RegionManager::get_cell_region_index(int row, int col) const {
+    if (row < 0 || row >= grid_size_ || col < 0 || col >= grid_size_) {
+        return -1;
+    }
+    return cell_to_index_[index(row, col)];
+}
+
+RegionView RegionManager::region_at(int index) const {
+    std::span<const uint16_t> cells(cells_.data() + cell_offsets_[index],
+                                    cells_.data() + cell_offsets_[index + 1]);
+    return {index, ids_[index], colors_[index], required_[index], RegionCells(cells, grid_size_)};
+}
+
+int RegionManager::count(int index, const Grid& grid, Cell value) const {
+    int total = 0;
+    int row = first_row_[index];
+    for (uint32_t mask : row_masks(index)) {
+        total += std::popcount(mask & grid.row_bits(row++, value));
+    }
+    return total;
+}
+
+void RegionManager::require_suns_of(const Grid& solution) {
+    for (int i = 0; i < region_count(); ++i) {
+        required_[i] = count(i, solution, Cell::Sun);
     }
-    return nullptr;
 }
 
 void RegionManager::clear() {
-    regions_.clear();
     std::fill(cell_to_region_.begin(), cell_to_region_.end(), -1);
+    std::fill(cell_to_index_.begin(), cell_to_index_.end(), -1);
+    id_to_index_.clear();
+    ids_.clear();
+    colors_.clear();
+    required_.clear();
+    first_row_.clear();
+    cells_.clear();
+    cell_offsets_.assign(1, 0);
+    row_masks_.clear();
+    mask_offsets_.assign(1, 0);
 }
 
 bool RegionManager::is_complete() const {
@@ -3,52 +3,209 @@
 #include "grid.h"
 #include <vector>
 #include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <memory_resource>
+#include <optional>
+#include <span>
 
 namespace eclipse {
 
-// A region is a colored group of cells with a constraint
+// A region is a colored group of cells with a constraint.
+// This is the description passed to RegionManager::add_region; the manager
+// itself keeps regions in a flat layout and hands out RegionViews.
 struct Region {
     int id;
     uint32_t color; // RGB color for display
     std::vector<Position> cells;
     int required_suns;  // Number of suns required in this region
-    
+
     Region(int id, uint32_t color) : id(id), color(color), required_suns(0) {}
 };
 
-// Manages regions for the puzzle
+// Cells of one region, read from the manager's flat cell-index array
+class RegionCells {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = Position;
+        using reference = Position;
+        using pointer = void;
+
+        iterator() = default;
+        iterator(const uint16_t* it, int grid_size) : it_(it), grid_size_(grid_size) {}
+
+        Position operator*() const { return {*it_ / grid_size_, *it_ % grid_size_}; }
+
+        iterator& operator++() { ++it_; return *this; }
+        iterator operator++(int) { iterator old = *this; ++it_; return old; }
+
+        bool operator==(const iterator& other) const { return it_ == other.it_; }
+
+    private:
+        const uint16_t* it_ = nullptr;
+        int grid_size_ = 1;
+    };
+
+    RegionCells(std::span<const uint16_t> indices, int grid_size)
+        : indices_(indices), grid_size_(grid_size) {}
+
+    iterator begin() const { return {indices_.data(), grid_size_}; }
+    iterator end() const { return {indices_.data() + indices_.size(), grid_size_}; }
+
+    size_t size() const { return indices_.size(); }
+    bool empty() const { return indices_.empty(); }
+    Position operator[](size_t i) const { return {indices_[i] / grid_size_, indices_[i] % grid_size_}; }
+
+    // Row-major cell indices (row * grid_size + col)
+    std::span<const uint16_t> indices() const { return indices_; }
+
+private:
+    std::span<const uint16_t> indices_;
+    int grid_size_;
+};
+
+// Read-only view of one region stored in a RegionManager
+struct RegionView {
+    int index;          // Dense index, 0 .. region_count() - 1
+    int id;
+    uint32_t color;
+    int required_suns;
+    RegionCells cells;
+};
+
+class RegionManager;
+
+// All regions of a manager, in the order they were added
+class RegionRange {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = RegionView;
+        using reference = RegionView;
+        using pointer = void;
+
+        iterator() = default;
+        iterator(const RegionManager* manager, int index) : manager_(manager), index_(index) {}
+
+        RegionView operator*() const;
+
+        iterator& operator++() { ++index_; return *this; }
+        iterator operator++(int) { iterator old = *this; ++index_; return old; }
+
+        bool operator==(const iterator& other) const { return index_ == other.index_; }
+
+    private:
+        const RegionManager* manager_ = nullptr;
+        int index_ = 0;
+    };
+
+    explicit RegionRange(const RegionManager& manager) : manager_(&manager) {}
+
+    iterator begin() const { return {manager_, 0}; }
+    iterator end() const { return {manager_, static_cast<int>(size())}; }
+
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+    RegionView operator[](size_t index) const;
+
+private:
+    const RegionManager* manager_;
+};
+
+// Manages regions for the puzzle.
+// Regions are stored compressed: the cells of every region sit in one
+// contiguous index array delimited by per-region offsets, ids map to dense
+// indices through a table, and each region has a row-mask per board row it
+// spans. Counting the Suns of a region is an AND and a popcount per row
+// against the grid's row masks.
 class RegionManager {
 public:
-    explicit RegionManager(int grid_size);
-    
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit RegionManager(int grid_size, allocator_type alloc = {});
+
+    RegionManager(const RegionManager& other) = default;
+    RegionManager(RegionManager&& other) = default;
+    RegionManager(const RegionManager& other, allocator_type alloc);
+    RegionManager& operator=(const RegionManager& other) = default;
+    RegionManager& operator=(RegionManager&& other) = default;
+
+    allocator_type get_allocator() const { return cells_.get_allocator(); }
+
     // Generate random regions (for puzzle generation)
     void generate_random_regions(int num_regions, unsigned seed);
-    
-    // Add a region
+
+    // Add a region. Regions don't overlap: throws std::invalid_argument for
+    // a negative or repeated id, or a cell that is out of bounds or taken.
     void add_region(const Region& region);
-    
+
     // Get region for a cell
     int get_region_id(int row, int col) const;
-    const Region* get_region(int region_id) const;
-    
+    std::optional<RegionView> get_region(int region_id) const;
+
+    // Dense index of a region id / a cell's region, or -1 (both O(1))
+    int get_region_index(int region_id) const;
+    int get_cell_region_index(int row, int col) const;
+
     // Get all regions
-    const std::vector<Region>& get_regions() const { return regions_; }
-    
+    RegionRange get_regions() const { return RegionRange(*this); }
+    int region_count() const { return static_cast<int>(ids_.size()); }
+    RegionView region_at(int index) const;
+
+    // Row masks of a region, the first one for row first_row(index)
+    int first_row(int index) const { return first_row_[index]; }
+    std::span<const uint32_t> row_masks(int index) const {
+        return {row_masks_.data() + mask_offsets_[index],
+                row_masks_.data() + mask_offsets_[index + 1]};
+    }
+
+    // Cells of a region holding value (Sun or Moon) in the grid
+    int count(int index, const Grid& grid, Cell value) const;
+
+    // Set every region's requirement to the Suns it holds in a solved grid
+    void require_suns_of(const Grid& solution);
+
     // Clear all regions
     void clear();
-    
+
     // Check if every cell is assigned to a region
     bool is_complete() const;
-    
+
     int grid_size() const { return grid_size_; }
-    
+
 private:
     int grid_size_;
-    std::vector<Region> regions_;
-    std::vector<int> cell_to_region_;  // Maps cell index to region ID
-    
+    std::pmr::vector<int> cell_to_region_;   // Maps cell index to region ID
+    std::pmr::vector<int> cell_to_index_;    // Maps cell index to dense index
+    std::pmr::vector<int> id_to_index_;      // Maps region ID to dense index
+
+    // Per region, by dense index
+    std::pmr::vector<int> ids_;
+    std::pmr::vector<uint32_t> colors_;
+    std::pmr::vector<int> required_;
+    std::pmr::vector<int> first_row_;
+
+    // Region i owns cells_[cell_offsets_[i] .. cell_offsets_[i + 1]) and
+    // row_masks_[mask_offsets_[i] .. mask_offsets_[i + 1])
+    std::pmr::vector<uint16_t> cells_;
+    std::pmr::vector<uint32_t> cell_offsets_;
+    std::pmr::vector<uint32_t> row_masks_;
+    std::pmr::vector<uint32_t> mask_offsets_;
+
     int index(int row, int col) const { return row * grid_size_ + col; }
+
+    void append_region(int id, uint32_t color, int required_suns, std::span<const Position> cells);
 };
 
-} // namespace eclipse
+inline RegionView RegionRange::iterator::operator*() const { return manager_->region_at(index_); }
+inline size_t RegionRange::size() const { return static_cast<size_t>(manager_->region_count()); }
+inline RegionView RegionRange::operator[](size_t index) const {
+    return manager_->region_at(static_cast<int>(index));
+}
 
+} // namespace eclipse
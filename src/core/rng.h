@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+namespace eclipse {
+
+// Small, fast pseudo-random generator with fully specified output.
+// The engine is xoshiro256** seeded through SplitMix64, and bounded draws
+// and shuffles use fixed algorithms defined here rather than the standard
+// library's distributions, whose output differs between implementations.
+// The same seed gives the same sequence on every compiler and platform,
+// so desktop and web builds generate identical puzzles.
+class Rng {
+public:
+    // Usable as a UniformRandomBitGenerator
+    using result_type = uint64_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+
+    explicit Rng(uint64_t seed = 0) { reseed(seed); }
+
+    // Restart the sequence; a handful of multiplies, cheap enough per attempt
+    void reseed(uint64_t seed) {
+        for (uint64_t& word : state_) {
+            seed += 0x9e3779b97f4a7c15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    result_type operator()() { return next(); }
+
+    uint64_t next() {
+        uint64_t result = rotl(state_[1] * 5, 7) * 9;
+        uint64_t t = state_[1] << 17;
+
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotl(state_[3], 45);
+
+        return result;
+    }
+
+    // Uniform in [0, bound), bound > 0. Lemire's multiply-and-reject: one
+    // draw and no division except in the rare rejection case.
+    uint32_t below(uint32_t bound) {
+        uint64_t product = (next() >> 32) * bound;
+        uint32_t low = static_cast<uint32_t>(product);
+        if (low < bound) {
+            uint32_t threshold = (0u - bound) % bound;
+            while (low < threshold) {
+                product = (next() >> 32) * bound;
+                low = static_cast<uint32_t>(product);
+            }
+        }
+        return static_cast<uint32_t>(product >> 32);
+    }
+
+    // Uniform in [low, high], low <= high
+    int uniform(int low, int high) {
+        uint32_t span = static_cast<uint32_t>(high) - static_cast<uint32_t>(low) + 1;
+        return static_cast<int>(static_cast<uint32_t>(low) + below(span));
+    }
+
+    // Fisher-Yates, from the back
+    template <typename RandomIt>
+    void shuffle(RandomIt first, RandomIt last) {
+        auto n = static_cast<uint32_t>(std::distance(first, last));
+        for (uint32_t i = n; i > 1; --i) {
+            using std::swap;
+            swap(first[i - 1], first[below(i)]);
+        }
+    }
+
+    // Advance by 2^128 draws. Streams taken from one seed by jumping never
+    // overlap in practice, so they can run in parallel.
+    void jump() {
+        constexpr uint64_t kJump[] = {0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull,
+                                      0xa9582618e03fc9aaull, 0x39abdc4529b1661cull};
+
+        uint64_t jumped[4] = {0, 0, 0, 0};
+        for (uint64_t bits : kJump) {
+            for (int b = 0; b < 64; ++b) {
+                if ((bits >> b) & 1u) {
+                    for (int i = 0; i < 4; ++i) jumped[i] ^= state_[i];
+                }
+                next();
+            }
+        }
+        for (int i = 0; i < 4; ++i) state_[i] = jumped[i];
+    }
+
+    // A generator for an independent stream: this one's current sequence,
+    // while this one jumps ahead past it
+    Rng split() {
+        Rng stream = *this;
+        jump();
+        return stream;
+    }
+
+    bool operator==(const Rng& other) const {
+        for (int i = 0; i < 4; ++i) {
+            if (state_[i] != other.state_[i]) return false;
+        }
+        return true;
+    }
+
+private:
+    uint64_t state_[4];
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+} // namespace eclipse
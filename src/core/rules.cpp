@@ -0,0 +1,397 @@
+#include "rules.h"
+#include "constraints.h"
+#include <algorithm>
+#include <bit>
+
+namespace eclipse {
+
+namespace {
+
+// Orthogonal neighbours: up, down, left, right; d ^ 1 is the opposite side
+constexpr std::array<Position, 4> kDirections = {{{-1, 0}, {1, 0}, {0, -1}, {0, 1}}};
+
+// Windows of three starting at [pos - 2, pos], clipped to the board
+uint32_t windows_covering(int pos, int size) {
+    int first = std::max(0, pos - 2);
+    int last = std::min(pos, size - 3);
+    if (first > last) return 0;
+    return ((uint32_t{2} << last) - 1) & ~((uint32_t{1} << first) - 1);
+}
+
+// Five-cell neighbourhoods, bit 2 the cell itself, in which filling the
+// cell makes three in a row: bit w is set for neighbourhood w
+constexpr uint32_t kTripleWindows = [] {
+    uint32_t table = 0;
+    for (uint32_t w = 0; w < 32; ++w) {
+        if ((w & 0x03) == 0x03 || (w & 0x0A) == 0x0A || (w & 0x18) == 0x18) table |= uint32_t{1} << w;
+    }
+    return table;
+}();
+
+// Would setting bit pos of a line mask complete three equal values?
+// Bits beyond either end of the board are clear in the mask, so edges need
+// no special case.
+bool completes_triple(uint32_t line, int pos) {
+    uint32_t window = static_cast<uint32_t>((uint64_t{line} << 2) >> pos) & 0x1B;
+    return (kTripleWindows >> window) & 1u;
+}
+
+// Row mask of a value, empty outside the board
+uint32_t row_or_zero(const Grid& grid, int row, Cell value) {
+    return (row >= 0 && row < grid.size()) ? grid.row_bits(row, value) : 0u;
+}
+
+} // namespace
+
+// LineBalanceRule
+
+bool LineBalanceRule::allows(const Grid& grid, int row, int col, Cell value) const {
+    int half = grid.size() / 2;
+
+    // Count the row and column excluding the current cell
+    uint32_t row_bits = grid.row_bits(row, value) & ~(uint32_t{1} << col);
+    uint32_t col_bits = grid.col_bits(col, value) & ~(uint32_t{1} << row);
+    return std::popcount(row_bits) < half && std::popcount(col_bits) < half;
+}
+
+void LineBalanceRule::restrict(const Grid& grid, CandidateMasks& masks) const {
+    int size = grid.size();
+    int half = size / 2;
+
+    // Columns that can still take a Sun / a Moon
+    uint32_t col_sun_open = 0;
+    uint32_t col_moon_open = 0;
+    for (int c = 0; c < size; ++c) {
+        if (std::popcount(grid.col_bits(c, Cell::Sun)) < half) col_sun_open |= uint32_t{1} << c;
+        if (std::popcount(grid.col_bits(c, Cell::Moon)) < half) col_moon_open |= uint32_t{1} << c;
+    }
+
+    for (int r = 0; r < size; ++r) {
+        masks.sun[r] &= std::popcount(grid.row_bits(r, Cell::Sun)) < half ? col_sun_open : 0;
+        masks.moon[r] &= std::popcount(grid.row_bits(r, Cell::Moon)) < half ? col_moon_open : 0;
+    }
+}
+
+int LineBalanceRule::count(const Grid& grid) const {
+    int half = grid.size() / 2;
+    int lines = 0;
+    for (int i = 0; i < grid.size(); ++i) {
+        for (Cell value : {Cell::Sun, Cell::Moon}) {
+            lines += (std::popcount(grid.row_bits(i, value)) > half) +
+                     (std::popcount(grid.col_bits(i, value)) > half);
+        }
+    }
+    return lines;
+}
+
+int LineBalanceRule::count_at(const Grid& grid, int row, int col) const {
+    int half = grid.size() / 2;
+    int lines = 0;
+    for (Cell value : {Cell::Sun, Cell::Moon}) {
+        lines += (std::popcount(grid.row_bits(row, value)) > half) +
+                 (std::popcount(grid.col_bits(col, value)) > half);
+    }
+    return lines;
+}
+
+uint32_t LineBalanceRule::conflicts(const Grid& grid, int row) const {
+    int half = grid.size() / 2;
+    uint32_t conflicts = 0;
+
+    for (Cell value : {Cell::Sun, Cell::Moon}) {
+        // Over-full row, and over-full columns crossing it
+        uint32_t x = grid.row_bits(row, value);
+        if (std::popcount(x) > half) conflicts |= x;
+        for (int c = 0; c < grid.size(); ++c) {
+            if (std::popcount(grid.col_bits(c, value)) > half) conflicts |= x & (uint32_t{1} << c);
+        }
+    }
+    return conflicts;
+}
+
+// NoThreeRule
+
+bool NoThreeRule::allows(const Grid& grid, int row, int col, Cell value) const {
+    // One lookup along the row, one down the column
+    return !completes_triple(grid.row_bits(row, value), col) &&
+           !completes_triple(grid.col_bits(col, value), row);
+}
+
+void NoThreeRule::restrict(const Grid& grid, CandidateMasks& masks) const {
+    // Cells that would complete a line of three, for a whole row at once:
+    // horizontally from the row mask, vertically from the masks of the two
+    // rows above and below
+    for (int r = 0; r < grid.size(); ++r) {
+        for (Cell value : {Cell::Sun, Cell::Moon}) {
+            auto bits = [&](int row) { return row_or_zero(grid, row, value); };
+            uint32_t x = bits(r);
+            uint32_t horizontal = ((x >> 1) & (x >> 2)) | ((x << 1) & (x << 2)) | ((x << 1) & (x >> 1));
+            uint32_t vertical = (bits(r - 1) & bits(r - 2)) |
+                                (bits(r + 1) & bits(r + 2)) |
+                                (bits(r - 1) & bits(r + 1));
+
+            auto& target = value == Cell::Sun ? masks.sun : masks.moon;
+            target[r] &= ~(horizontal | vertical);
+        }
+    }
+}
+
+int NoThreeRule::count(const Grid& grid) const {
+    int triples = 0;
+    for (int r = 0; r < grid.size(); ++r) {
+        for (Cell value : {Cell::Sun, Cell::Moon}) {
+            uint32_t x = grid.row_bits(r, value);
+            triples += std::popcount(x & (x >> 1) & (x >> 2));
+            triples += std::popcount(x & row_or_zero(grid, r - 1, value) & row_or_zero(grid, r - 2, value));
+        }
+    }
+    return triples;
+}
+
+int NoThreeRule::count_at(const Grid& grid, int row, int col) const {
+    int size = grid.size();
+    int triples = 0;
+    for (Cell value : {Cell::Sun, Cell::Moon}) {
+        uint32_t x = grid.row_bits(row, value);
+        uint32_t y = grid.col_bits(col, value);
+        triples += std::popcount(x & (x >> 1) & (x >> 2) & windows_covering(col, size));
+        triples += std::popcount(y & (y >> 1) & (y >> 2) & windows_covering(row, size));
+    }
+    return triples;
+}
+
+uint32_t NoThreeRule::conflicts(const Grid& grid, int row) const {
+    uint32_t conflicts = 0;
+    for (Cell value : {Cell::Sun, Cell::Moon}) {
+        auto bits = [&](int r) { return row_or_zero(grid, r, value); };
+        uint32_t x = bits(row);
+
+        // Cells inside a run of three
+        uint32_t starts = x & (x >> 1) & (x >> 2);
+        conflicts |= starts | (starts << 1) | (starts << 2);
+        conflicts |= x & ((bits(row - 2) & bits(row - 1)) |
+                          (bits(row - 1) & bits(row + 1)) |
+                          (bits(row + 1) & bits(row + 2)));
+    }
+    return conflicts;
+}
+
+// RegionRule
+
+void RegionRule::bind(const PuzzleTopology& topology, int) {
+    regions_ = &topology.regions;
+}
+
+bool RegionRule::allows(const Grid& grid, int row, int col, Cell value) const {
+    int region = regions_->get_cell_region_index(row, col);
+    if (region == -1) return true;  // No region constraint
+
+    RegionView view = regions_->region_at(region);
+    int required = view.required_suns;
+    int suns = regions_->count(region, grid, Cell::Sun);
+    int moons = regions_->count(region, grid, Cell::Moon);
+
+    // Suns in this region, excluding the current cell
+    int sun_count = suns - (grid.get(row, col) == Cell::Sun ? 1 : 0);
+
+    // Check if adding this value would exceed the required count
+    if (value == Cell::Sun && sun_count >= required) {
+        return false;
+    }
+
+    if (value == Cell::Moon) {
+        // If we place a moon, we need enough empty cells for remaining suns
+        int empty_count = static_cast<int>(view.cells.size()) - suns - moons;
+        int remaining_suns = required - sun_count;
+        if (remaining_suns > empty_count - 1) {  // -1 because we're filling current cell
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void RegionRule::restrict(const Grid& grid, CandidateMasks& masks) const {
+    // Region counts, once per region
+    for (int i = 0; i < regions_->region_count(); ++i) {
+        RegionView region = regions_->region_at(i);
+        int sun_count = regions_->count(i, grid, Cell::Sun);
+        int empty_count = static_cast<int>(region.cells.size()) - sun_count -
+                          regions_->count(i, grid, Cell::Moon);
+
+        bool sun_blocked = sun_count >= region.required_suns;
+        bool moon_blocked = region.required_suns - sun_count > empty_count - 1;
+        if (!sun_blocked && !moon_blocked) continue;
+
+        int row = regions_->first_row(i);
+        for (uint32_t mask : regions_->row_masks(i)) {
+            if (sun_blocked) masks.sun[row] &= ~mask;
+            if (moon_blocked) masks.moon[row] &= ~mask;
+            row++;
+        }
+    }
+}
+
+int RegionRule::count(const Grid& grid) const {
+    int broken = 0;
+    for (int i = 0; i < regions_->region_count(); ++i) {
+        if (violated(grid, i)) broken++;
+    }
+    return broken;
+}
+
+int RegionRule::count_at(const Grid& grid, int row, int col) const {
+    int region = regions_->get_cell_region_index(row, col);
+    return region != -1 && violated(grid, region) ? 1 : 0;
+}
+
+uint32_t RegionRule::conflicts(const Grid& grid, int row) const {
+    uint32_t conflicts = 0;
+
+    // Broken regions: their Suns if over-full, else their Moons
+    for (int i = 0; i < regions_->region_count(); ++i) {
+        int first = regions_->first_row(i);
+        auto masks = regions_->row_masks(i);
+        if (row < first || row >= first + static_cast<int>(masks.size())) continue;
+        if (!masks[row - first] || !violated(grid, i)) continue;
+
+        bool too_many_suns = regions_->count(i, grid, Cell::Sun) > regions_->region_at(i).required_suns;
+        conflicts |= masks[row - first] & grid.row_bits(row, too_many_suns ? Cell::Sun : Cell::Moon);
+    }
+    return conflicts;
+}
+
+bool RegionRule::violated(const Grid& grid, int index) const {
+    int required = regions_->region_at(index).required_suns;
+    int cells = static_cast<int>(regions_->region_at(index).cells.size());
+    int suns = regions_->count(index, grid, Cell::Sun);
+    int moons = regions_->count(index, grid, Cell::Moon);
+
+    return suns > required || (moons > 0 && cells - moons < required);
+}
+
+// ClueRule
+
+void ClueRule::bind(const PuzzleTopology& topology, int size) {
+    size_ = size;
+    equal_dirs_.assign(size * size, 0);
+    not_equal_dirs_.assign(size * size, 0);
+    clued_cells_.clear();
+
+    auto in_bounds = [&](Position pos) {
+        return pos.row >= 0 && pos.row < size && pos.col >= 0 && pos.col < size;
+    };
+
+    // Pairs already given a clue (None included), per cell and direction
+    std::pmr::vector<uint8_t> seen(size * size, 0, equal_dirs_.get_allocator());
+
+    for (const auto& clue : topology.clues) {
+        Position a = clue.cell1;
+        Position b = clue.cell2;
+        if (!in_bounds(a) || !in_bounds(b)) continue;
+
+        for (int dir = 0; dir < 4; ++dir) {
+            if (a.row + kDirections[dir].row != b.row || a.col + kDirections[dir].col != b.col) continue;
+
+            // A later clue on the same pair is ignored
+            int ia = a.row * size + a.col;
+            int ib = b.row * size + b.col;
+            if ((seen[ia] >> dir) & 1u) break;
+            seen[ia] |= 1u << dir;
+            seen[ib] |= 1u << (dir ^ 1);
+
+            if (clue.type == RelationshipClue::None) break;
+            auto& dirs = clue.type == RelationshipClue::Equal ? equal_dirs_ : not_equal_dirs_;
+            dirs[ia] |= 1u << dir;
+            dirs[ib] |= 1u << (dir ^ 1);
+        }
+    }
+
+    for (int index = 0; index < size * size; ++index) {
+        if (equal_dirs_[index] | not_equal_dirs_[index]) {
+            clued_cells_.push_back(static_cast<uint16_t>(index));
+        }
+    }
+}
+
+bool ClueRule::allows(const Grid& grid, int row, int col, Cell value) const {
+    int index = row * size_ + col;
+    uint8_t dirs = equal_dirs_[index] | not_equal_dirs_[index];
+
+    for (int dir = 0; dir < 4; ++dir) {
+        if (!((dirs >> dir) & 1u)) continue;
+
+        Cell neighbor_value = grid.get(row + kDirections[dir].row, col + kDirections[dir].col);
+        if (neighbor_value == Cell::Empty) continue;
+
+        bool equal = (equal_dirs_[index] >> dir) & 1u;
+        if (equal ? value != neighbor_value : value == neighbor_value) return false;
+    }
+    return true;
+}
+
+void ClueRule::restrict(const Grid& grid, CandidateMasks& masks) const {
+    // Clues with one side filled restrict the other side
+    for (uint16_t index : clued_cells_) {
+        int row = index / size_;
+        int col = index % size_;
+        if (!grid.is_empty(row, col)) continue;
+
+        for (int dir = 0; dir < 4; ++dir) {
+            bool equal = (equal_dirs_[index] >> dir) & 1u;
+            bool not_equal = (not_equal_dirs_[index] >> dir) & 1u;
+            if (!equal && !not_equal) continue;
+
+            Cell other = grid.get(row + kDirections[dir].row, col + kDirections[dir].col);
+            if (other == Cell::Empty) continue;
+
+            // Equal forbids the opposite value, NotEqual the same value
+            Cell forbidden = not_equal ? other : (other == Cell::Sun ? Cell::Moon : Cell::Sun);
+            auto& target = forbidden == Cell::Sun ? masks.sun : masks.moon;
+            target[row] &= ~(uint32_t{1} << col);
+        }
+    }
+}
+
+int ClueRule::count(const Grid& grid) const {
+    // Each pair counted from its upper or left cell
+    int broken = 0;
+    for (uint16_t index : clued_cells_) {
+        int row = index / size_;
+        int col = index % size_;
+        if (violated(grid, row, col, 1)) broken++;
+        if (violated(grid, row, col, 3)) broken++;
+    }
+    return broken;
+}
+
+int ClueRule::count_at(const Grid& grid, int row, int col) const {
+    int broken = 0;
+    for (int dir = 0; dir < 4; ++dir) {
+        if (violated(grid, row, col, dir)) broken++;
+    }
+    return broken;
+}
+
+uint32_t ClueRule::conflicts(const Grid& grid, int row) const {
+    uint32_t conflicts = 0;
+    for (int col = 0; col < size_; ++col) {
+        if (count_at(grid, row, col) > 0) conflicts |= uint32_t{1} << col;
+    }
+    return conflicts;
+}
+
+bool ClueRule::violated(const Grid& grid, int row, int col, int dir) const {
+    int index = row * size_ + col;
+    bool equal = (equal_dirs_[index] >> dir) & 1u;
+    bool not_equal = (not_equal_dirs_[index] >> dir) & 1u;
+    if (!equal && !not_equal) return false;
+
+    Cell value = grid.get(row, col);
+    Cell other = grid.get(row + kDirections[dir].row, col + kDirections[dir].col);
+    if (value == Cell::Empty || other == Cell::Empty) return false;
+
+    return equal ? value != other : value == other;
+}
+
+} // namespace eclipse
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "grid.h"
+#include "region.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace eclipse {
+
+struct PuzzleTopology;
+
+// Relationship clue between two adjacent cells
+struct Clue {
+    Position cell1;
+    Position cell2;
+    RelationshipClue type;
+};
+
+// Legal values for every empty cell of the board, one bit per column.
+// Bit c of sun[r] is set if a Sun may be placed at (r, c); filled cells
+// have neither bit set. The rows can sit on a puzzle's resource, like its
+// grid.
+struct CandidateMasks {
+    std::pmr::vector<uint32_t> sun;
+    std::pmr::vector<uint32_t> moon;
+};
+
+// A rule is a plain class with the members below; RuleSet combines rules
+// at compile time, so every call is direct and can be inlined.
+//
+//   void bind(const PuzzleTopology& topology, int size);
+//       Called when the layout changes; rules keep what they need of it.
+//   bool allows(const Grid& grid, int row, int col, Cell value) const;
+//       Could value (Sun or Moon) go at (row, col), ignoring what is there?
+//   void restrict(const Grid& grid, CandidateMasks& masks) const;
+//       Clear the candidates this rule forbids, for the whole board.
+//   int count(const Grid& grid) const;
+//       Number of instances of the rule the board breaks.
+//   int count_at(const Grid& grid, int row, int col) const;
+//       The same, over only the instances that involve (row, col).
+//   uint32_t conflicts(const Grid& grid, int row) const;
+//       Filled cells of a row inside a broken instance, bit c for column c.
+//
+// Rules holding memory take an allocator_type in their constructors, like
+// Grid; RuleSet passes the puzzle's allocator on.
+
+// Each row and column holds size/2 Suns and size/2 Moons
+class LineBalanceRule {
+public:
+    void bind(const PuzzleTopology&, int) {}
+    bool allows(const Grid& grid, int row, int col, Cell value) const;
+    void restrict(const Grid& grid, CandidateMasks& masks) const;
+    int count(const Grid& grid) const;
+    int count_at(const Grid& grid, int row, int col) const;
+    uint32_t conflicts(const Grid& grid, int row) const;
+};
+
+// No three equal values in a row, horizontally or vertically
+class NoThreeRule {
+public:
+    void bind(const PuzzleTopology&, int) {}
+    bool allows(const Grid& grid, int row, int col, Cell value) const;
+    void restrict(const Grid& grid, CandidateMasks& masks) const;
+    int count(const Grid& grid) const;
+    int count_at(const Grid& grid, int row, int col) const;
+    uint32_t conflicts(const Grid& grid, int row) const;
+};
+
+// Each region holds exactly its required number of Suns
+class RegionRule {
+public:
+    void bind(const PuzzleTopology& topology, int size);
+    bool allows(const Grid& grid, int row, int col, Cell value) const;
+    void restrict(const Grid& grid, CandidateMasks& masks) const;
+    int count(const Grid& grid) const;
+    int count_at(const Grid& grid, int row, int col) const;
+    uint32_t conflicts(const Grid& grid, int row) const;
+
+private:
+    const RegionManager* regions_ = nullptr;
+
+    // Too many Suns, or a Moon has taken room the missing Suns needed
+    bool violated(const Grid& grid, int index) const;
+};
+
+// = and ≠ clues between adjacent cells; the first clue given for a pair wins
+class ClueRule {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit ClueRule(allocator_type alloc = {})
+        : equal_dirs_(alloc), not_equal_dirs_(alloc), clued_cells_(alloc) {}
+    ClueRule(const ClueRule& other, allocator_type alloc)
+        : size_(other.size_),
+          equal_dirs_(other.equal_dirs_, alloc),
+          not_equal_dirs_(other.not_equal_dirs_, alloc),
+          clued_cells_(other.clued_cells_, alloc) {}
+
+    void bind(const PuzzleTopology& topology, int size);
+    bool allows(const Grid& grid, int row, int col, Cell value) const;
+    void restrict(const Grid& grid, CandidateMasks& masks) const;
+    int count(const Grid& grid) const;
+    int count_at(const Grid& grid, int row, int col) const;
+    uint32_t conflicts(const Grid& grid, int row) const;
+
+private:
+    int size_ = 0;
+
+    // Per cell, bit d set if the neighbour in direction d carries a clue
+    std::pmr::vector<uint8_t> equal_dirs_;
+    std::pmr::vector<uint8_t> not_equal_dirs_;
+    std::pmr::vector<uint16_t> clued_cells_;  // Cells with any clue
+
+    bool violated(const Grid& grid, int row, int col, int dir) const;
+};
+
+// A fixed set of rules applied together. Queries fold over the rules in
+// order; violation counts are kept per rule.
+template <typename... Rules>
+class RuleSet {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    static constexpr size_t kCount = sizeof...(Rules);
+
+    // Broken instances of each rule, in the order the rules are listed
+    struct Counts {
+        std::array<int, kCount> per_rule{};
+
+        int total() const {
+            int sum = 0;
+            for (int count : per_rule) sum += count;
+            return sum;
+        }
+
+        template <typename Rule>
+        int of() const { return per_rule[index_of<Rule>()]; }
+
+        Counts& operator+=(const Counts& other) {
+            for (size_t i = 0; i < kCount; ++i) per_rule[i] += other.per_rule[i];
+            return *this;
+        }
+        Counts& operator-=(const Counts& other) {
+            for (size_t i = 0; i < kCount; ++i) per_rule[i] -= other.per_rule[i];
+            return *this;
+        }
+    };
+
+    explicit RuleSet(allocator_type alloc = {}) : rules_(make<Rules>(alloc)...) {}
+    RuleSet(const RuleSet& other) = default;
+    RuleSet(RuleSet&& other) = default;
+    RuleSet(const RuleSet& other, allocator_type alloc)
+        : RuleSet(other, alloc, std::index_sequence_for<Rules...>{}) {}
+    RuleSet& operator=(const RuleSet& other) = default;
+    RuleSet& operator=(RuleSet&& other) = default;
+
+    template <typename Rule>
+    const Rule& get() const { return std::get<Rule>(rules_); }
+
+    void bind(const PuzzleTopology& topology, int size) {
+        std::apply([&](auto&... rule) { (rule.bind(topology, size), ...); }, rules_);
+    }
+
+    bool allows(const Grid& grid, int row, int col, Cell value) const {
+        if (value == Cell::Empty) return true;
+        return std::apply([&](const auto&... rule) {
+            return (rule.allows(grid, row, col, value) && ...);
+        }, rules_);
+    }
+
+    void restrict(const Grid& grid, CandidateMasks& masks) const {
+        std::apply([&](const auto&... rule) { (rule.restrict(grid, masks), ...); }, rules_);
+    }
+
+    Counts count(const Grid& grid) const {
+        return std::apply([&](const auto&... rule) {
+            return Counts{{rule.count(grid)...}};
+        }, rules_);
+    }
+
+    Counts count_at(const Grid& grid, int row, int col) const {
+        return std::apply([&](const auto&... rule) {
+            return Counts{{rule.count_at(grid, row, col)...}};
+        }, rules_);
+    }
+
+    uint32_t conflicts(const Grid& grid, int row) const {
+        return std::apply([&](const auto&... rule) {
+            return (rule.conflicts(grid, row) | ... | 0u);
+        }, rules_);
+    }
+
+private:
+    std::tuple<Rules...> rules_;
+
+    template <size_t... I>
+    RuleSet(const RuleSet& other, allocator_type alloc, std::index_sequence<I...>)
+        : rules_(copy(std::get<I>(other.rules_), alloc)...) {}
+
+    template <typename Rule>
+    static Rule make(allocator_type alloc) {
+        if constexpr (std::is_constructible_v<Rule, allocator_type>) return Rule(alloc);
+        else return Rule();
+    }
+
+    template <typename Rule>
+    static Rule copy(const Rule& rule, allocator_type alloc) {
+        if constexpr (std::is_constructible_v<Rule, const Rule&, allocator_type>) return Rule(rule, alloc);
+        else return rule;
+    }
+
+    template <typename Rule>
+    static constexpr size_t index_of() {
+        constexpr std::array<bool, kCount> matches = {std::is_same_v<Rule, Rules>...};
+        for (size_t i = 0; i < kCount; ++i) {
+            if (matches[i]) return i;
+        }
+        return kCount;
+    }
+};
+
+// The rules of the game, in the order placements are checked
+using StandardRules = RuleSet<LineBalanceRule, NoThreeRule, RegionRule, ClueRule>;
+
+} // namespace eclipse
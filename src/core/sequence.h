@@ -0,0 +1,114 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace eclipse {
+
+// Lazily evaluated sequence backed by a C++20 coroutine.
+// Values are produced on demand with co_yield and handed out by reference;
+// a yielded reference stays valid until the iterator is advanced.
+template <typename T>
+class Sequence {
+public:
+    struct promise_type {
+        const T* current = nullptr;
+        std::exception_ptr exception;
+
+        Sequence get_return_object() {
+            return Sequence{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        std::suspend_always yield_value(const T& value) noexcept {
+            current = std::addressof(value);
+            return {};
+        }
+
+        void return_void() noexcept {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T;
+        using reference = const T&;
+        using pointer = const T*;
+
+        iterator() = default;
+        explicit iterator(Handle handle) : handle_(handle) {}
+
+        reference operator*() const { return *handle_.promise().current; }
+        pointer operator->() const { return handle_.promise().current; }
+
+        iterator& operator++() {
+            Sequence::advance(handle_);
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        bool operator==(std::default_sentinel_t) const {
+            return !handle_ || handle_.done();
+        }
+
+    private:
+        Handle handle_;
+    };
+
+    Sequence() = default;
+    explicit Sequence(Handle handle) : handle_(handle) {}
+
+    Sequence(Sequence&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Sequence& operator=(Sequence&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+
+    Sequence(const Sequence&) = delete;
+    Sequence& operator=(const Sequence&) = delete;
+
+    ~Sequence() { reset(); }
+
+    // Starts (or continues) the coroutine up to its next value
+    iterator begin() {
+        if (handle_ && !handle_.done() && !handle_.promise().current) {
+            advance(handle_);
+        }
+        return iterator{handle_};
+    }
+
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    Handle handle_;
+
+    void reset() {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = {};
+        }
+    }
+
+    static void advance(Handle handle) {
+        handle.promise().current = nullptr;
+        handle.resume();
+        if (handle.promise().exception) {
+            std::rethrow_exception(std::exchange(handle.promise().exception, {}));
+        }
+    }
+};
+
+} // namespace eclipse
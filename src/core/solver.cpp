@@ -1,121 +1,138 @@
 #include "solver.h"
 #include <algorithm>
+#include <bit>
 
 namespace eclipse {
 
-Solver::Solver(Puzzle& puzzle) : puzzle_(puzzle) {}
+Solver::Solver(Puzzle& puzzle)
+    : puzzle_(puzzle),
+      stack_(puzzle.grid().get_allocator()),
+      candidates_{std::pmr::vector<uint32_t>(puzzle.grid().get_allocator()),
+                  std::pmr::vector<uint32_t>(puzzle.grid().get_allocator())} {
+    stack_.reserve(static_cast<size_t>(puzzle.size()) * puzzle.size());
+}
 
 bool Solver::solve() {
     // First apply constraint propagation
     propagate();
     
-    // Then use backtracking if needed
-    return solve_recursive();
+    // Then search; the first solution is left in the grid
+    reset_search();
+    return next_solution();
 }
 
-bool Solver::solve_recursive() {
-    // Check if complete
-    if (puzzle_.grid().is_complete()) {
-        return puzzle_.is_valid();
+int Solver::count_solutions(int max_count) {
+    int count = 0;
+    reset_search();
+    while (count < max_count && next_solution()) {
+        count++;
     }
     
-    // Find best cell to fill (MRV heuristic)
-    auto best_cell = find_best_cell();
-    if (!best_cell) {
-        return false;  // No valid cell to fill
+    // Leave the grid as we found it
+    unwind_search();
+    return count;
+}
+
+Sequence<Grid> Solver::solutions() {
+    // Runs however the caller stops: exhaustion, early exit or destruction
+    struct Unwinder {
+        Solver& solver;
+        ~Unwinder() { solver.unwind_search(); }
+    } unwinder{*this};
+    
+    reset_search();
+    while (next_solution()) {
+        co_yield puzzle_.grid();
     }
+}
+
+void Solver::reset_search() {
+    stack_.clear();
+    search_started_ = false;
+    search_exhausted_ = false;
+    nodes_visited_ = 0;
+}
+
+bool Solver::next_solution() {
+    if (search_exhausted_) return false;
     
-    int row = best_cell->row;
-    int col = best_cell->col;
+    if (!search_started_) {
+        search_started_ = true;
+        
+        // Every assignment made below passes is_valid_placement, so a grid
+        // that starts out valid is still valid once complete. Checking the
+        // givens once here replaces a full validation at every leaf.
+        if (!puzzle_.is_valid()) {
+            search_exhausted_ = true;
+            return false;
+        }
+    } else if (!backtrack()) {
+        // Resume from the previously reported solution
+        search_exhausted_ = true;
+        return false;
+    }
     
-    // Get possible values
-    auto possible = puzzle_.get_possible_values(row, col);
+    while (!puzzle_.grid().is_complete()) {
+        if (!extend()) {
+            // Dead end: some cell has no legal value
+            if (!backtrack()) {
+                search_exhausted_ = true;
+                return false;
+            }
+        }
+    }
     
-    // Try Sun first, then Moon
-    for (Cell value : {Cell::Sun, Cell::Moon}) {
-        if (!possible[static_cast<int>(value)]) continue;
-        
-        // Make move
-        puzzle_.grid().set(row, col, value);
+    return true;
+}
+
+bool Solver::backtrack() {
+    while (!stack_.empty()) {
+        Decision& top = stack_.back();
         
-        // Recurse
-        if (solve_recursive()) {
+        if (top.moon_pending) {
+            // Moon was legal when this level was opened, and every deeper
+            // assignment has been undone, so it is still legal now
+            top.value = Cell::Moon;
+            top.moon_pending = false;
+            puzzle_.grid().set(top.row, top.col, Cell::Moon);
+            nodes_visited_++;
             return true;
         }
         
-        // Backtrack
-        puzzle_.grid().set(row, col, Cell::Empty);
+        puzzle_.grid().set(top.row, top.col, Cell::Empty);
+        stack_.pop_back();
     }
     
     return false;
 }
 
-int Solver::count_solutions(int max_count) {
-    int count = 0;
-    count_solutions_recursive(count, max_count);
-    return count;
-}
-
-void Solver::count_solutions_recursive(int& count, int max_count) {
-    if (count >= max_count) return;
-    
-    // Check if complete
-    if (puzzle_.grid().is_complete()) {
-        if (puzzle_.is_valid()) {
-            count++;
-        }
-        return;
-    }
-    
-    // Find best cell
-    auto best_cell = find_best_cell();
-    if (!best_cell) return;
-    
-    int row = best_cell->row;
-    int col = best_cell->col;
-    
-    auto possible = puzzle_.get_possible_values(row, col);
-    
-    for (Cell value : {Cell::Sun, Cell::Moon}) {
-        if (!possible[static_cast<int>(value)]) continue;
-        
-        puzzle_.grid().set(row, col, value);
-        count_solutions_recursive(count, max_count);
-        puzzle_.grid().set(row, col, Cell::Empty);
-        
-        if (count >= max_count) return;
+void Solver::unwind_search() {
+    while (!stack_.empty()) {
+        const Decision& top = stack_.back();
+        puzzle_.grid().set(top.row, top.col, Cell::Empty);
+        stack_.pop_back();
     }
+    search_exhausted_ = true;
 }
 
 std::vector<LogicalStep> Solver::get_forced_moves() const {
     std::vector<LogicalStep> forced;
     
+    CandidateMasks candidates;
+    puzzle_.compute_candidates(candidates);
+    
     for (int r = 0; r < puzzle_.size(); ++r) {
-        for (int c = 0; c < puzzle_.size(); ++c) {
-            if (!puzzle_.grid().is_empty(r, c)) continue;
+        // Only one possible value - this is forced
+        uint32_t single = candidates.sun[r] ^ candidates.moon[r];
+        while (single) {
+            int c = std::countr_zero(single);
+            single &= single - 1;
             
-            auto possible = puzzle_.get_possible_values(r, c);
-            
-            // Count how many values are possible (excluding Empty)
-            int count = 0;
-            Cell forced_value = Cell::Empty;
-            if (possible[static_cast<int>(Cell::Sun)]) {
-                count++;
-                forced_value = Cell::Sun;
-            }
-            if (possible[static_cast<int>(Cell::Moon)]) {
-                count++;
-                forced_value = Cell::Moon;
-            }
-            
-            if (count == 1) {
-                // Only one possible value - this is forced
-                LogicalStep step;
-                step.position = {r, c};
-                step.value = forced_value;
-                step.reason = "Only valid placement";
-                forced.push_back(step);
-            }
+            LogicalStep step;
+            step.position = {r, c};
+            step.value = ((candidates.sun[r] >> c) & 1u) ? Cell::Sun : Cell::Moon;
+            step.reason = "Only valid placement";
+            forced.push_back(step);
         }
     }
     
@@ -123,99 +140,104 @@ std::vector<LogicalStep> Solver::get_forced_moves() const {
 }
 
 bool Solver::propagate() {
-    bool progress = true;
     bool any_progress = false;
     
-    while (progress) {
-        progress = false;
+    while (true) {
+        puzzle_.compute_candidates(candidates_);
         
+        bool progress = false;
         for (int r = 0; r < puzzle_.size(); ++r) {
-            for (int c = 0; c < puzzle_.size(); ++c) {
-                if (propagate_cell(r, c)) {
-                    progress = true;
-                    any_progress = true;
-                }
+            uint32_t single = candidates_.sun[r] ^ candidates_.moon[r];
+            while (single) {
+                int c = std::countr_zero(single);
+                single &= single - 1;
+                Cell value = ((candidates_.sun[r] >> c) & 1u) ? Cell::Sun : Cell::Moon;
+                
+                // An earlier fill in this pass may have ruled this one out
+                if (!puzzle_.is_valid_placement(r, c, value)) continue;
+                
+                puzzle_.grid().set(r, c, value);
+                progress = true;
             }
         }
+        
+        if (!progress) break;
+        any_progress = true;
     }
     
     return any_progress;
 }
 
-bool Solver::propagate_cell(int row, int col) {
-    if (!puzzle_.grid().is_empty(row, col)) return false;
-    
-    auto possible = puzzle_.get_possible_values(row, col);
+bool Solver::extend() {
+    puzzle_.compute_candidates(candidates_);
     
-    int count = 0;
-    Cell forced_value = Cell::Empty;
+    const Grid& grid = puzzle_.grid();
+    int size = puzzle_.size();
     
-    if (possible[static_cast<int>(Cell::Sun)]) {
-        count++;
-        forced_value = Cell::Sun;
-    }
-    if (possible[static_cast<int>(Cell::Moon)]) {
-        count++;
-        forced_value = Cell::Moon;
+    for (int r = 0; r < size; ++r) {
+        if (grid.empty_bits(r) & ~(candidates_.sun[r] | candidates_.moon[r])) {
+            return false;
+        }
     }
     
-    if (count == 1) {
-        // Only one possible value, fill it
-        puzzle_.grid().set(row, col, forced_value);
+    // Propagate first: every cell with a single legal value is filled in
+    // this pass, each as its own level so backtracking undoes it. A fill
+    // earlier in the pass can rule a later one out, so each is rechecked.
+    size_t depth = stack_.size();
+    for (int r = 0; r < size; ++r) {
+        uint32_t sun = candidates_.sun[r];
+        uint32_t single = sun ^ candidates_.moon[r];
+        while (single) {
+            int c = std::countr_zero(single);
+            single &= single - 1;
+            
+            Cell value = ((sun >> c) & 1u) ? Cell::Sun : Cell::Moon;
+            if (!puzzle_.is_valid_placement(r, c, value)) continue;
+            
+            puzzle_.grid().set(r, c, value);
+            stack_.push_back({r, c, value, false});
+            nodes_visited_++;
+        }
+    }
+    if (stack_.size() > depth) {
         return true;
     }
     
-    return false;
-}
-
-std::optional<Position> Solver::find_best_cell() const {
-    std::optional<Position> best;
-    int min_choices = 3;  // More than possible
-    
-    for (int r = 0; r < puzzle_.size(); ++r) {
-        for (int c = 0; c < puzzle_.size(); ++c) {
-            if (!puzzle_.grid().is_empty(r, c)) continue;
-            
-            auto possible = puzzle_.get_possible_values(r, c);
-            int count = 0;
-            if (possible[static_cast<int>(Cell::Sun)]) count++;
-            if (possible[static_cast<int>(Cell::Moon)]) count++;
-            
-            if (count == 0) {
-                // No valid values - unsolvable
-                return std::nullopt;
-            }
-            
-            if (count < min_choices) {
-                min_choices = count;
-                best = Position{r, c};
-                
-                if (count == 1) {
-                    // Can't do better than 1 choice
-                    return best;
-                }
-            }
+    // Nothing forced: branch on the first open cell, Sun first, then Moon
+    for (int r = 0; r < size; ++r) {
+        uint32_t both = candidates_.sun[r] & candidates_.moon[r];
+        if (both) {
+            int c = std::countr_zero(both);
+            puzzle_.grid().set(r, c, Cell::Sun);
+            stack_.push_back({r, c, Cell::Sun, true});
+            nodes_visited_++;
+            return true;
         }
     }
     
-    return best;
+    return false;
 }
 
 bool Solver::is_solvable() const {
+    CandidateMasks candidates;
+    puzzle_.compute_candidates(candidates);
+    
     // Check if any cell has no possible values
+    const Grid& grid = puzzle_.grid();
     for (int r = 0; r < puzzle_.size(); ++r) {
-        for (int c = 0; c < puzzle_.size(); ++c) {
-            if (!puzzle_.grid().is_empty(r, c)) continue;
-            
-            auto possible = puzzle_.get_possible_values(r, c);
-            if (!possible[static_cast<int>(Cell::Sun)] && 
-                !possible[static_cast<int>(Cell::Moon)]) {
-                return false;
-            }
+        uint32_t empty = grid.empty_bits(r);
+        if (empty & ~(candidates.sun[r] | candidates.moon[r])) {
+            return false;
         }
     }
     return true;
 }
 
-} // namespace eclipse
+bool Solver::propagate_to_contradiction() {
+    if (!puzzle_.is_valid()) return true;
+    
+    propagate();
+    return !puzzle_.is_valid() || !is_solvable();
+}
 
+} // namespace eclipse
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "constraints.h"
+#include "sequence.h"
 #include <optional>
+#include <memory_resource>
 #include <vector>
 #include <functional>
+#include <cstdint>
 
 namespace eclipse {
 
@@ -29,6 +32,13 @@ public:
     // Count solutions up to a maximum (for uniqueness checking)
     int count_solutions(int max_count = 2);
     
+    // Lazily enumerate solutions. Each element is a view of the puzzle's own
+    // grid, valid until the sequence is advanced; the search resumes from
+    // where it stopped instead of restarting. Destroying the sequence
+    // restores the grid. The solver must outlive the sequence and must not
+    // be used for anything else while it is alive.
+    Sequence<Grid> solutions();
+    
     // Get logical next steps (for hints)
     std::vector<LogicalStep> get_forced_moves() const;
     
@@ -38,18 +48,48 @@ public:
     // Check if puzzle is solvable
     bool is_solvable() const;
     
+    // Propagate, then report whether the board broke down: a rule is
+    // broken or some empty cell has no legal value left. False doesn't
+    // prove the board solvable, only that propagation found no dead end.
+    // The puzzle keeps the propagated cells.
+    bool propagate_to_contradiction();
+    
+    // Search nodes (assignments) visited by the last solve/count call
+    uint64_t nodes_visited() const { return nodes_visited_; }
+    
 private:
+    // One level of the explicit search stack
+    struct Decision {
+        int row;
+        int col;
+        Cell value;         // Value currently assigned at this level
+        bool moon_pending;  // Moon still to be tried after Sun
+    };
+    
     Puzzle& puzzle_;
     
-    // Backtracking solver
-    bool solve_recursive();
-    void count_solutions_recursive(int& count, int max_count);
+    // Preallocated to one entry per cell, so the search never grows it.
+    // Like the candidate buffer below, it comes from the puzzle's
+    // resource, so a solver on an arena puzzle stays off the heap.
+    std::pmr::vector<Decision> stack_;
+    bool search_started_ = false;
+    bool search_exhausted_ = false;
+    uint64_t nodes_visited_ = 0;
+    
+    // Iterative backtracking search. Each call resumes from the previous
+    // solution and returns true when the grid holds the next one.
+    void reset_search();
+    bool next_solution();
+    bool backtrack();
+    void unwind_search();
     
-    // Find cell with minimum remaining values (MRV heuristic)
-    std::optional<Position> find_best_cell() const;
+    // Candidate buffer reused by every full-board scan
+    CandidateMasks candidates_;
     
-    // Apply constraint propagation at a cell
-    bool propagate_cell(int row, int col);
+    // Extend the search by one step: fill every forced cell, or else open
+    // a Sun/Moon branch on one undecided cell. Returns false if some empty
+    // cell has no legal value.
+    bool extend();
 };
 
 } // namespace eclipse
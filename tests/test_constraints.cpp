@@ -1,5 +1,6 @@
 #include <catch2/catch_test_macros.hpp>
 #include "core/constraints.h"
+#include <optional>
 
 using namespace eclipse;
 
@@ -30,11 +31,59 @@ TEST_CASE("Grid basic operations", "[grid]") {
         Grid clone = grid.clone();
         REQUIRE(clone.get(1, 1) == Cell::Moon);
     }
+    
+    SECTION("Row and column views read the grid in place") {
+        grid.set(2, 3, Cell::Sun);
+        auto row = grid.get_row(2);
+        auto col = grid.get_col(3);
+        REQUIRE(row.size() == 6);
+        REQUIRE(col.size() == 6);
+        REQUIRE(row[3] == Cell::Sun);
+        REQUIRE(col[2] == Cell::Sun);
+        
+        grid.set(4, 3, Cell::Moon);
+        REQUIRE(col[4] == Cell::Moon);
+        
+        int filled = 0;
+        for (Cell cell : col) {
+            if (cell != Cell::Empty) filled++;
+        }
+        REQUIRE(filled == 2);
+        
+        // The last column walks its rows in order and stops at the bottom
+        grid.set(5, 5, Cell::Moon);
+        std::vector<Cell> last(grid.get_col(5).begin(), grid.get_col(5).end());
+        REQUIRE(last.size() == 6);
+        REQUIRE(last.back() == Cell::Moon);
+        REQUIRE(std::distance(col.begin(), col.end()) == 6);
+    }
+    
+    SECTION("Empty cells are tracked as the grid changes") {
+        REQUIRE(grid.empty_count() == 36);
+        grid.set(0, 0, Cell::Sun);
+        grid.set(0, 0, Cell::Moon);
+        grid.set(5, 4, Cell::Sun);
+        REQUIRE(grid.empty_count() == 34);
+        
+        int visited = 0;
+        Position last{-1, -1};
+        for (Position pos : grid.empty_cells()) {
+            REQUIRE(grid.is_empty(pos.row, pos.col));
+            REQUIRE(pos.row * 6 + pos.col > last.row * 6 + last.col);
+            last = pos;
+            visited++;
+        }
+        REQUIRE(visited == 34);
+        
+        grid.set(0, 0, Cell::Empty);
+        REQUIRE(grid.empty_count() == 35);
+        REQUIRE_FALSE(grid.is_complete());
+    }
 }
 
 TEST_CASE("Constraint validation", "[constraints]") {
     Puzzle puzzle(6);
-    puzzle.regions().generate_random_regions(6, 777);
+    puzzle.mutable_regions().generate_random_regions(6, 777);
     
     SECTION("Row count constraint") {
         // Fill row with 3 suns (valid for 6x6)
@@ -58,6 +107,36 @@ TEST_CASE("Constraint validation", "[constraints]") {
     }
 }
 
+TEST_CASE("No-three check agrees with the neighbours", "[constraints]") {
+    // Every Sun/Moon/Empty pattern of one row, placed in the middle of the
+    // board and checked at every column against the cells either side; the
+    // same pattern down a column must give the same answers
+    const int size = 6;
+    NoThreeRule rule;
+    
+    for (int pattern = 0; pattern < 729; ++pattern) {
+        Grid grid(size);
+        Grid transposed(size);
+        int code = pattern;
+        for (int c = 0; c < size; ++c) {
+            grid.set(2, c, static_cast<Cell>(code % 3));
+            transposed.set(c, 2, static_cast<Cell>(code % 3));
+            code /= 3;
+        }
+        
+        for (int c = 0; c < size; ++c) {
+            for (Cell value : {Cell::Sun, Cell::Moon}) {
+                auto same = [&](int col) { return col >= 0 && col < size && grid.get(2, col) == value; };
+                bool triple = (same(c - 2) && same(c - 1)) ||
+                              (same(c - 1) && same(c + 1)) ||
+                              (same(c + 1) && same(c + 2));
+                REQUIRE(rule.allows(grid, 2, c, value) == !triple);
+                REQUIRE(rule.allows(transposed, c, 2, value) == !triple);
+            }
+        }
+    }
+}
+
 TEST_CASE("Relationship clues", "[constraints]") {
     Puzzle puzzle(6);
     
@@ -129,4 +208,299 @@ TEST_CASE("Region constraints", "[regions]") {
         
         REQUIRE(assigned_count == 36);  // All cells in 6x6
     }
+    
+    SECTION("Flat layout agrees with the cell map") {
+        regions.generate_random_regions(6, 7);
+        Grid grid(6);
+        grid.set(0, 0, Cell::Sun);
+        grid.set(5, 5, Cell::Sun);
+        grid.set(2, 3, Cell::Moon);
+        
+        for (const auto& region : regions.get_regions()) {
+            REQUIRE(regions.get_region_index(region.id) == region.index);
+            
+            int suns = 0;
+            int moons = 0;
+            for (Position pos : region.cells) {
+                REQUIRE(regions.get_region_id(pos.row, pos.col) == region.id);
+                REQUIRE(regions.get_cell_region_index(pos.row, pos.col) == region.index);
+                if (grid.get(pos.row, pos.col) == Cell::Sun) suns++;
+                if (grid.get(pos.row, pos.col) == Cell::Moon) moons++;
+            }
+            REQUIRE(regions.count(region.index, grid, Cell::Sun) == suns);
+            REQUIRE(regions.count(region.index, grid, Cell::Moon) == moons);
+        }
+    }
+    
+    SECTION("Added regions must not overlap") {
+        Region top(3, 0xFF0000);
+        top.cells = {{0, 0}, {0, 1}};
+        regions.add_region(top);
+        REQUIRE(regions.get_region(3)->cells.size() == 2);
+        REQUIRE_FALSE(regions.get_region(4));
+        
+        Region clash(4, 0x00FF00);
+        clash.cells = {{0, 1}};
+        REQUIRE_THROWS(regions.add_region(clash));
+        REQUIRE_THROWS(regions.add_region(top));
+    }
+}
+
+TEST_CASE("Bulk candidates match per-cell checks", "[constraints]") {
+    Puzzle puzzle(8);
+    puzzle.mutable_regions().generate_random_regions(8, 31337);
+    puzzle.add_clue({{0, 0}, {0, 1}, RelationshipClue::Equal});
+    puzzle.add_clue({{3, 3}, {4, 3}, RelationshipClue::NotEqual});
+    
+    // A scattering of fills; validity does not matter for the comparison
+    for (int i = 0; i < 24; ++i) {
+        int r = (i * 5) % 8;
+        int c = (i * 3 + i / 8) % 8;
+        puzzle.grid().set(r, c, i % 3 == 0 ? Cell::Moon : Cell::Sun);
+    }
+    
+    CandidateMasks masks;
+    puzzle.compute_candidates(masks);
+    
+    for (int r = 0; r < 8; ++r) {
+        for (int c = 0; c < 8; ++c) {
+            bool sun = (masks.sun[r] >> c) & 1u;
+            bool moon = (masks.moon[r] >> c) & 1u;
+            
+            if (!puzzle.grid().is_empty(r, c)) {
+                REQUIRE_FALSE(sun);
+                REQUIRE_FALSE(moon);
+                continue;
+            }
+            
+            auto possible = puzzle.get_possible_values(r, c);
+            REQUIRE(sun == possible[static_cast<int>(Cell::Sun)]);
+            REQUIRE(moon == possible[static_cast<int>(Cell::Moon)]);
+        }
+    }
+}
+
+TEST_CASE("Puzzle copies share their topology", "[constraints]") {
+    Puzzle puzzle(6);
+    puzzle.mutable_regions().generate_random_regions(6, 99);
+    puzzle.add_clue({{0, 0}, {0, 1}, RelationshipClue::Equal});
+    
+    Puzzle copy = puzzle;
+    REQUIRE(copy.topology() == puzzle.topology());
+    
+    SECTION("Grid changes stay local") {
+        copy.grid().set(2, 2, Cell::Sun);
+        REQUIRE(puzzle.grid().is_empty(2, 2));
+        REQUIRE(copy.topology() == puzzle.topology());
+    }
+    
+    SECTION("Layout changes copy on write") {
+        copy.add_clue({{1, 0}, {1, 1}, RelationshipClue::NotEqual});
+        REQUIRE(copy.topology() != puzzle.topology());
+        REQUIRE(copy.get_clues().size() == 2);
+        REQUIRE(puzzle.get_clues().size() == 1);
+    }
+    
+    SECTION("Topology can be attached to a fresh state") {
+        Puzzle state(6);
+        state.set_topology(puzzle.topology());
+        REQUIRE(state.get_clue({0, 0}, {0, 1}) == RelationshipClue::Equal);
+        REQUIRE_THROWS(Puzzle(8).set_topology(puzzle.topology()));
+    }
+    
+    SECTION("Attached topologies are never written in place") {
+        auto layout = std::make_shared<const PuzzleTopology>(*puzzle.topology(),
+                                                             std::pmr::get_default_resource());
+        Puzzle state(6);
+        state.set_topology(layout);
+        state.add_clue({{1, 0}, {1, 1}, RelationshipClue::NotEqual});
+        REQUIRE(state.topology() != layout);
+        REQUIRE(layout->clues.size() == 1);
+        
+        // Once copied, the puzzle owns its topology and writes to it
+        auto owned = state.topology().get();
+        state.add_clue({{2, 0}, {2, 1}, RelationshipClue::Equal});
+        REQUIRE(state.topology().get() == owned);
+    }
+}
+
+TEST_CASE("Puzzles can live in an arena", "[constraints]") {
+    std::pmr::monotonic_buffer_resource arena;
+    Puzzle::allocator_type alloc(&arena);
+    
+    Puzzle puzzle(6, alloc);
+    puzzle.mutable_regions().generate_random_regions(6, 5);
+    puzzle.add_clue({{0, 0}, {0, 1}, RelationshipClue::Equal});
+    puzzle.grid().set(1, 1, Cell::Sun);
+    
+    REQUIRE(puzzle.grid().get_allocator().resource() == &arena);
+    REQUIRE(puzzle.regions().get_allocator().resource() == &arena);
+    
+    SECTION("Copy-on-write stays in the arena") {
+        Puzzle copy(puzzle, alloc);
+        copy.add_clue({{2, 2}, {2, 3}, RelationshipClue::NotEqual});
+        REQUIRE(copy.grid().get_allocator().resource() == &arena);
+        REQUIRE(copy.regions().get_allocator().resource() == &arena);
+    }
+    
+    SECTION("Copies off the arena take their own topology") {
+        Puzzle plain = puzzle;
+        REQUIRE(plain.topology() != puzzle.topology());
+        REQUIRE(plain.regions().get_allocator().resource() == std::pmr::get_default_resource());
+        
+        std::pmr::monotonic_buffer_resource other;
+        Puzzle moved(puzzle, &other);
+        REQUIRE(moved.regions().get_allocator().resource() == &other);
+        
+        Puzzle assigned(6);
+        assigned = puzzle;
+        REQUIRE(assigned.topology() != puzzle.topology());
+        REQUIRE(assigned.regions().get_allocator().resource() == std::pmr::get_default_resource());
+        
+        // Nothing of a copy points into an arena once it's gone, not even
+        // the violation tracking the source had set up
+        Puzzle kept(6);
+        std::optional<Puzzle> copied;
+        {
+            std::pmr::monotonic_buffer_resource scratch;
+            Puzzle inner(puzzle, &scratch);
+            inner.add_clue({{2, 2}, {2, 3}, RelationshipClue::NotEqual});
+            REQUIRE(inner.is_valid());
+            kept = inner;
+            copied.emplace(inner);
+        }
+        copied->set(2, 2, Cell::Sun);
+        copied->set(2, 3, Cell::Sun);
+        REQUIRE_FALSE(copied->is_valid());
+        kept.set(0, 5, Cell::Moon);
+        REQUIRE(kept.get_clue({2, 2}, {2, 3}) == RelationshipClue::NotEqual);
+        REQUIRE(kept.grid().get(1, 1) == Cell::Sun);
+        REQUIRE(kept.is_valid());
+    }
+    
+    SECTION("Clones leave the arena") {
+        Puzzle out = puzzle.clone();
+        REQUIRE(out.topology() != puzzle.topology());
+        REQUIRE(out.grid().get_allocator().resource() == std::pmr::get_default_resource());
+        REQUIRE(out.regions().get_allocator().resource() == std::pmr::get_default_resource());
+        REQUIRE(out.grid().get(1, 1) == Cell::Sun);
+        REQUIRE(out.get_clue({0, 0}, {0, 1}) == RelationshipClue::Equal);
+        REQUIRE(out.regions().region_count() == puzzle.regions().region_count());
+    }
+}
+
+TEST_CASE("Tracked validity matches per-cell checks", "[constraints]") {
+    Puzzle puzzle(6);
+    puzzle.mutable_regions().generate_random_regions(6, 2024);
+    puzzle.add_clue({{0, 0}, {0, 1}, RelationshipClue::Equal});
+    puzzle.add_clue({{2, 2}, {3, 2}, RelationshipClue::NotEqual});
+    puzzle.add_clue({{4, 4}, {4, 5}, RelationshipClue::NotEqual});
+    REQUIRE(puzzle.is_valid());
+    
+    // Reference: a filled cell conflicts if it could not be placed again
+    auto rejected = [](const Puzzle& p, int r, int c) {
+        Puzzle probe = p;
+        Cell value = probe.grid().get(r, c);
+        probe.grid().set(r, c, Cell::Empty);
+        return !probe.is_valid_placement(r, c, value);
+    };
+    
+    uint32_t state = 12345;
+    for (int step = 0; step < 400; ++step) {
+        state = state * 1664525u + 1013904223u;
+        int r = (state >> 8) % 6;
+        int c = (state >> 16) % 6;
+        puzzle.set(r, c, static_cast<Cell>((state >> 24) % 3));
+        
+        bool any_rejected = false;
+        for (int row = 0; row < 6; ++row) {
+            uint32_t conflicts = puzzle.conflict_bits(row);
+            for (int col = 0; col < 6; ++col) {
+                bool expected = !puzzle.grid().is_empty(row, col) && rejected(puzzle, row, col);
+                REQUIRE(((conflicts >> col) & 1u) == expected);
+                any_rejected |= expected;
+            }
+        }
+        REQUIRE(puzzle.is_valid() == !any_rejected);
+        
+        // A copy written through the grid recounts from scratch
+        Puzzle rebuilt(6);
+        rebuilt.set_topology(puzzle.topology());
+        rebuilt.grid() = puzzle.grid();
+        REQUIRE(rebuilt.violations().total() == puzzle.violations().total());
+    }
+}
+
+namespace {
+
+// Forbids Suns on the main diagonal
+struct NoDiagonalSunRule {
+    void bind(const PuzzleTopology&, int) {}
+    bool allows(const Grid&, int row, int col, Cell value) const {
+        return !(row == col && value == Cell::Sun);
+    }
+    void restrict(const Grid& grid, CandidateMasks& masks) const {
+        for (int r = 0; r < grid.size(); ++r) masks.sun[r] &= ~(1u << r);
+    }
+    int count(const Grid& grid) const {
+        int broken = 0;
+        for (int i = 0; i < grid.size(); ++i) broken += count_at(grid, i, i);
+        return broken;
+    }
+    int count_at(const Grid& grid, int row, int col) const {
+        return row == col && grid.get(row, col) == Cell::Sun ? 1 : 0;
+    }
+    uint32_t conflicts(const Grid& grid, int row) const {
+        return count_at(grid, row, row) ? 1u << row : 0u;
+    }
+};
+
+} // namespace
+
+TEST_CASE("Rule sets combine rules", "[constraints]") {
+    Puzzle puzzle(6);
+    puzzle.mutable_regions().generate_random_regions(6, 99);
+    
+    using Rules = RuleSet<LineBalanceRule, NoDiagonalSunRule>;
+    Rules rules;
+    rules.bind(*puzzle.topology(), 6);
+    
+    Grid grid(6);
+    grid.set(1, 1, Cell::Sun);
+    grid.set(1, 2, Cell::Sun);
+    grid.set(1, 3, Cell::Sun);
+    grid.set(1, 4, Cell::Sun);
+    
+    SECTION("Queries fold over every rule") {
+        REQUIRE_FALSE(rules.allows(grid, 2, 2, Cell::Sun));
+        REQUIRE_FALSE(rules.allows(grid, 1, 5, Cell::Sun));
+        REQUIRE(rules.allows(grid, 2, 3, Cell::Sun));
+        REQUIRE(rules.allows(grid, 2, 2, Cell::Moon));
+        
+        CandidateMasks masks{std::pmr::vector<uint32_t>(6, 0x3F), std::pmr::vector<uint32_t>(6, 0x3F)};
+        rules.restrict(grid, masks);
+        REQUIRE((masks.sun[2] & (1u << 2)) == 0);
+        REQUIRE(masks.sun[1] == 0);
+        REQUIRE(masks.moon[2] == 0x3F);
+    }
+    
+    SECTION("Counts are kept per rule") {
+        Rules::Counts counts = rules.count(grid);
+        REQUIRE(counts.of<LineBalanceRule>() == 1);
+        REQUIRE(counts.of<NoDiagonalSunRule>() == 1);
+        REQUIRE(counts.total() == 2);
+        
+        Rules::Counts at = rules.count_at(grid, 1, 1);
+        REQUIRE(at.of<NoDiagonalSunRule>() == 1);
+        REQUIRE(rules.conflicts(grid, 1) & (1u << 1));
+    }
+    
+    SECTION("Puzzles report the standard rules separately") {
+        puzzle.set(0, 0, Cell::Sun);
+        puzzle.set(0, 1, Cell::Sun);
+        puzzle.set(0, 2, Cell::Sun);
+        REQUIRE(puzzle.violations().of<NoThreeRule>() == 1);
+        REQUIRE(puzzle.violations().of<ClueRule>() == 0);
+        REQUIRE(puzzle.violations().of<LineBalanceRule>() == 0);
+    }
 }
@@ -1,6 +1,10 @@
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include "core/generator.h"
 #include "core/solver.h"
+#include "core/rng.h"
+#include <string>
+#include <vector>
 
 using namespace eclipse;
 
@@ -89,3 +93,140 @@ TEST_CASE("Generator can create different difficulty levels", "[generator]") {
         REQUIRE(puzzle->size() == 8);
     }
 }
+
+TEST_CASE("Random streams are the same on every platform", "[generator][rng]") {
+    // Golden values; any change here changes every daily puzzle
+    SECTION("Raw output") {
+        Rng rng(42);
+        REQUIRE(rng.next() == 0x15780b2e0c2ec716ull);
+        REQUIRE(rng.next() == 0x6104d9866d113a7eull);
+        REQUIRE(rng.next() == 0xae17533239e499a1ull);
+    }
+    
+    SECTION("Bounded draws and shuffles") {
+        Rng rng(42);
+        std::vector<uint32_t> draws;
+        for (int i = 0; i < 10; ++i) draws.push_back(rng.below(6));
+        REQUIRE(draws == std::vector<uint32_t>{0, 2, 4, 5, 5, 4, 4, 5, 4, 3});
+        
+        Rng shuffler(7);
+        std::vector<int> values = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+        shuffler.shuffle(values.begin(), values.end());
+        REQUIRE(values == std::vector<int>{1, 8, 3, 0, 4, 5, 9, 6, 2, 7});
+    }
+    
+    SECTION("Split streams") {
+        Rng rng(42);
+        Rng stream = rng.split();
+        REQUIRE(stream == Rng(42));
+        REQUIRE(rng.next() == 0x50086ef83cbf4f4aull);
+        
+        Rng jumped(42);
+        jumped.jump();
+        jumped.next();
+        REQUIRE(rng == jumped);
+    }
+}
+
+TEST_CASE("Generated puzzles are fixed by their seed", "[generator]") {
+    auto generate = [](Difficulty difficulty, int max_empty_cells) {
+        GeneratorConfig config;
+        config.seed = 42;
+        config.grid_size = 6;
+        config.difficulty = difficulty;
+        config.num_regions = 6;
+        config.max_empty_cells = max_empty_cells;
+        
+        Generator generator(config);
+        return generator.generate();
+    };
+    
+    auto describe = [](const Puzzle& puzzle, std::string& cells, std::string& regions) {
+        for (int r = 0; r < 6; ++r) {
+            for (int c = 0; c < 6; ++c) {
+                Cell value = puzzle.grid().get(r, c);
+                cells += value == Cell::Sun ? 'S' : value == Cell::Moon ? 'M' : '.';
+                regions += static_cast<char>('0' + puzzle.regions().get_region_id(r, c));
+            }
+        }
+    };
+    
+    SECTION("Easy") {
+        // Propagation alone solves this board, so no clue adds a deduction
+        // and none is placed
+        auto puzzle = generate(Difficulty::Easy, 20);
+        std::string cells;
+        std::string regions;
+        describe(*puzzle, cells, regions);
+        REQUIRE(cells == "SMS..S...M..M...MS...M.MMS.S.MS..S..");
+        REQUIRE(regions == "000004300044310444312444112255122255");
+        REQUIRE(puzzle->get_clues().empty());
+    }
+    
+    SECTION("Medium, with clues") {
+        auto puzzle = generate(Difficulty::Medium, 30);
+        std::string cells;
+        std::string regions;
+        describe(*puzzle, cells, regions);
+        REQUIRE(cells == "S.S..S...M..M..........M.....M......");
+        REQUIRE(regions == "000004300044310444312444112255122255");
+        REQUIRE(puzzle->get_clues().size() == 2);
+        REQUIRE(puzzle->get_clue({0, 2}, {1, 2}) == RelationshipClue::Equal);
+        REQUIRE(puzzle->get_clue({2, 4}, {3, 4}) == RelationshipClue::NotEqual);
+    }
+}
+
+TEST_CASE("Relationship clues follow the solution", "[generator]") {
+    for (unsigned seed = 1; seed <= 5; ++seed) {
+        GeneratorConfig config;
+        config.seed = seed;
+        config.grid_size = 6;
+        config.difficulty = Difficulty::Hard;
+        config.max_empty_cells = 30;
+        
+        Generator generator(config);
+        auto puzzle = generator.generate();
+        REQUIRE(Solver(*puzzle).count_solutions(2) == 1);
+        
+        // The clues hold in the unique solution
+        Puzzle solved = *puzzle;
+        REQUIRE(Solver(solved).solve());
+        REQUIRE(solved.is_solved());
+        REQUIRE(solved.violations().of<ClueRule>() == 0);
+    }
+}
+
+TEST_CASE("Generator scales to large boards", "[generator]") {
+    for (int size : {10, 14}) {
+        GeneratorConfig config;
+        config.seed = 2024;
+        config.grid_size = size;
+        config.num_regions = size;
+        config.max_empty_cells = size * size / 2;
+        
+        Generator generator(config);
+        auto puzzle = generator.generate();
+        REQUIRE(puzzle->size() == size);
+        REQUIRE(puzzle->regions().is_complete());
+        REQUIRE(puzzle->grid().empty_count() == size * size / 2);
+        
+        Solver solver(*puzzle);
+        REQUIRE(solver.count_solutions(2) == 1);
+    }
+}
+
+TEST_CASE("Generation time by board size", "[.][benchmark]") {
+    // Hidden; run with: eclipse_tests "[benchmark]"
+    for (int size : {6, 8, 10, 14, 20}) {
+        GeneratorConfig config;
+        config.grid_size = size;
+        config.num_regions = size;
+        config.max_empty_cells = size * size / 2;
+        
+        BENCHMARK("Generate " + std::to_string(size) + "x" + std::to_string(size)) {
+            config.seed++;
+            Generator generator(config);
+            return generator.generate();
+        };
+    }
+}
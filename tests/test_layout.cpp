@@ -0,0 +1,78 @@
+#include <catch2/catch_test_macros.hpp>
+#include "app/board_layout.h"
+
+using namespace eclipse;
+
+TEST_CASE("Board layouts map pixels to cells", "[layout]") {
+    // 6x6 board of 40 px cells from (100, 150) to (339, 389)
+    BoardLayout layout(6, 100, 150, 40);
+    REQUIRE(layout.pixels() == 240);
+    REQUIRE(layout.cell_x(5) == 300);
+    REQUIRE(layout.cell_y(5) == 350);
+    
+    SECTION("Corners and cell boundaries") {
+        REQUIRE(layout.cell_at(100, 150) == Position{0, 0});
+        REQUIRE(layout.cell_at(139, 189) == Position{0, 0});
+        REQUIRE(layout.cell_at(140, 189) == Position{0, 1});
+        REQUIRE(layout.cell_at(139, 190) == Position{1, 0});
+        REQUIRE(layout.cell_at(140, 190) == Position{1, 1});
+        REQUIRE(layout.cell_at(339, 389) == Position{5, 5});
+    }
+    
+    SECTION("Pixels just outside each edge") {
+        REQUIRE_FALSE(layout.cell_at(99, 200).has_value());
+        REQUIRE_FALSE(layout.cell_at(340, 200).has_value());
+        REQUIRE_FALSE(layout.cell_at(200, 149).has_value());
+        REQUIRE_FALSE(layout.cell_at(200, 390).has_value());
+        REQUIRE_FALSE(layout.cell_at(340, 390).has_value());
+    }
+    
+    SECTION("Negative coordinates") {
+        // Truncating division would put these in row or column 0
+        BoardLayout origin(6, 0, 0, 40);
+        REQUIRE(origin.cell_at(0, 0) == Position{0, 0});
+        REQUIRE_FALSE(origin.cell_at(-1, 0).has_value());
+        REQUIRE_FALSE(origin.cell_at(0, -1).has_value());
+        REQUIRE_FALSE(origin.cell_at(-39, -39).has_value());
+        REQUIRE_FALSE(layout.cell_at(-500, -500).has_value());
+    }
+    
+    SECTION("Every pixel maps to the cell drawn there") {
+        int wrong = 0;
+        for (int py = 140; py < 400; ++py) {
+            for (int px = 90; px < 350; ++px) {
+                auto cell = layout.cell_at(px, py);
+                bool inside = px >= 100 && px < 340 && py >= 150 && py < 390;
+                if (cell.has_value() != inside) {
+                    ++wrong;
+                } else if (cell) {
+                    int x = layout.cell_x(cell->col);
+                    int y = layout.cell_y(cell->row);
+                    wrong += px < x || px >= x + 40 || py < y || py >= y + 40;
+                }
+            }
+        }
+        REQUIRE(wrong == 0);
+    }
+}
+
+TEST_CASE("Board layouts fit the window", "[layout]") {
+    SECTION("The tighter side decides") {
+        REQUIRE(BoardLayout::fit(6, 100, 150, 600, 300, 60).cell_size() == 50);
+        REQUIRE(BoardLayout::fit(6, 100, 150, 300, 600, 60).cell_size() == 50);
+        REQUIRE(BoardLayout::fit(6, 100, 150, 1000, 1000, 60).cell_size() == 60);
+    }
+    
+    SECTION("Small windows stop at the minimum cell size") {
+        constexpr int kMin = BoardLayout::kMinCellSize;
+        REQUIRE(BoardLayout::fit(6, 100, 150, 6 * kMin, 6 * kMin, 60).cell_size() == kMin);
+        REQUIRE(BoardLayout::fit(6, 100, 150, 6 * kMin - 1, 600, 60).cell_size() == kMin);
+        REQUIRE(BoardLayout::fit(6, 100, 150, 30, 30, 60).cell_size() == kMin);
+        
+        // A window narrower than the margins leaves a negative area
+        BoardLayout squeezed = BoardLayout::fit(6, 100, 150, -220, -100, 60);
+        REQUIRE(squeezed.cell_size() == kMin);
+        REQUIRE(squeezed.cell_at(100, 150) == Position{0, 0});
+        REQUIRE(squeezed.cell_at(100 + 6 * kMin - 1, 150) == Position{0, 5});
+    }
+}
@@ -0,0 +1,115 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/move_log.h"
+#include "core/rng.h"
+#include <vector>
+
+using namespace eclipse;
+
+TEST_CASE("Move logs replay, seek and round-trip", "[moves]") {
+    auto same = [](const Grid& a, const Grid& b) {
+        for (int r = 0; r < a.size(); ++r) {
+            if (a.row_bits(r, Cell::Sun) != b.row_bits(r, Cell::Sun) ||
+                a.row_bits(r, Cell::Moon) != b.row_bits(r, Cell::Moon)) return false;
+        }
+        return true;
+    };
+    
+    Grid board(8);
+    board.set(0, 0, Cell::Sun);
+    MoveLog log(board);
+    
+    // Enough moves for several snapshots, with the board after each
+    std::vector<Grid> boards{board};
+    Rng rng(3);
+    for (int i = 0; i < 300; ++i) {
+        int row = rng.uniform(0, 7);
+        int col = rng.uniform(0, 7);
+        Cell value = static_cast<Cell>(rng.uniform(0, 2));
+        log.record({{row, col}, board.get(row, col), value}, rng.below(5000));
+        board.set(row, col, value);
+        boards.push_back(board);
+    }
+    REQUIRE(log.size() == 300);
+    
+    SECTION("Any point can be reached") {
+        for (size_t i = 0; i <= log.size(); ++i) {
+            REQUIRE(same(log.board_at(i), boards[i]));
+        }
+        REQUIRE(same(log.seek(130), boards[130]));
+        REQUIRE(log.cursor() == 130);
+    }
+    
+    SECTION("Points past the end are rejected") {
+        log.seek(130);
+        REQUIRE_THROWS_AS(log.board_at(301), std::out_of_range);
+        REQUIRE_THROWS_AS(log.seek(301), std::out_of_range);
+        REQUIRE(log.cursor() == 130);
+        REQUIRE_THROWS_AS(log.at(300), std::out_of_range);
+        REQUIRE_THROWS_AS(log.delta_ms(300), std::out_of_range);
+        REQUIRE_NOTHROW(log.at(299));
+        
+        log.seek(0);
+        REQUIRE_THROWS_AS(log.undo(), std::out_of_range);
+        REQUIRE(log.cursor() == 0);
+        log.seek(300);
+        REQUIRE_THROWS_AS(log.redo(), std::out_of_range);
+    }
+    
+    SECTION("Undo and redo walk the log") {
+        Move last = log.undo();
+        REQUIRE(last.new_value == boards[300].get(last.position.row, last.position.col));
+        REQUIRE(log.can_redo());
+        REQUIRE(log.redo().position == last.position);
+        REQUIRE_FALSE(log.can_redo());
+    }
+    
+    SECTION("Recording after undo drops the undone moves") {
+        Grid at = log.seek(128);
+        log.record({{7, 7}, at.get(7, 7), Cell::Moon});
+        REQUIRE(log.size() == 129);
+        REQUIRE_FALSE(log.can_redo());
+        at.set(7, 7, Cell::Moon);
+        REQUIRE(same(log.board_at(129), at));
+        REQUIRE(same(log.board_at(100), boards[100]));
+    }
+    
+    SECTION("Serialized logs load back") {
+        log.seek(77);
+        std::vector<uint8_t> data = log.serialize();
+        REQUIRE(data.size() < 300 * 4 + 32);
+        
+        MoveLog loaded = MoveLog::deserialize(data);
+        REQUIRE(loaded.size() == 300);
+        REQUIRE(loaded.cursor() == 77);
+        REQUIRE(loaded.delta_ms(42) == log.delta_ms(42));
+        REQUIRE(same(loaded.board_at(300), boards[300]));
+        REQUIRE(loaded.serialize() == data);
+        
+        std::vector<uint8_t> truncated(data.begin(), data.end() - 1);
+        REQUIRE_THROWS_AS(MoveLog::deserialize(truncated), std::invalid_argument);
+        
+        std::vector<uint8_t> tampered = data;
+        tampered[0] = 'X';
+        REQUIRE_THROWS_AS(MoveLog::deserialize(tampered), std::invalid_argument);
+    }
+    
+    SECTION("Logs that don't add up are rejected") {
+        // One move on a 4x4 board: 7 header bytes (magic, version, size,
+        // count, cursor), 4 board bytes, then the move's two bytes
+        MoveLog small(Grid(4));
+        small.record({{0, 0}, Cell::Empty, Cell::Sun});
+        std::vector<uint8_t> data = small.serialize();
+        REQUIRE(data.size() == 7 + 4 + 3);
+        REQUIRE_NOTHROW(MoveLog::deserialize(data));
+        
+        // The move claims (0, 0) held a Moon, but the board has it empty
+        std::vector<uint8_t> flipped = data;
+        flipped[11] = static_cast<uint8_t>((flipped[11] & ~0x0C) | static_cast<int>(Cell::Moon) << 2);
+        REQUIRE_THROWS_WITH(MoveLog::deserialize(flipped), "Move log does not replay");
+        
+        // 3 is not a cell value
+        std::vector<uint8_t> bad_board = data;
+        bad_board[8] = 0x03;
+        REQUIRE_THROWS_WITH(MoveLog::deserialize(bad_board), "Move log has a malformed board");
+    }
+}
@@ -1,6 +1,11 @@
 #include <catch2/catch_test_macros.hpp>
 #include "core/solver.h"
+#include "core/forced_moves.h"
 #include "core/constraints.h"
+#include "core/model_counter.h"
+#include "core/fixed_solver.h"
+#include <set>
+#include <vector>
 
 using namespace eclipse;
 
@@ -8,7 +13,7 @@ TEST_CASE("Solver can solve simple puzzles", "[solver]") {
     Puzzle puzzle(6);
     
     // Create a simple solvable configuration
-    puzzle.regions().generate_random_regions(6, 12345);
+    puzzle.mutable_regions().generate_random_regions(6, 12345);
     
     // Add some initial clues
     puzzle.grid().set(0, 0, Cell::Sun);
@@ -33,7 +38,7 @@ TEST_CASE("Solver can solve simple puzzles", "[solver]") {
 
 TEST_CASE("Solver can count solutions", "[solver]") {
     Puzzle puzzle(6);
-    puzzle.regions().generate_random_regions(6, 54321);
+    puzzle.mutable_regions().generate_random_regions(6, 54321);
     
     Solver solver(puzzle);
     
@@ -46,7 +51,7 @@ TEST_CASE("Solver can count solutions", "[solver]") {
 
 TEST_CASE("Solver provides logical hints", "[solver]") {
     Puzzle puzzle(6);
-    puzzle.regions().generate_random_regions(6, 99999);
+    puzzle.mutable_regions().generate_random_regions(6, 99999);
     
     // Fill most of the grid
     for (int r = 0; r < 5; ++r) {
@@ -66,7 +71,7 @@ TEST_CASE("Solver provides logical hints", "[solver]") {
 
 TEST_CASE("Solver validates constraints", "[solver]") {
     Puzzle puzzle(6);
-    puzzle.regions().generate_random_regions(6, 11111);
+    puzzle.mutable_regions().generate_random_regions(6, 11111);
     
     SECTION("Empty puzzle is not complete") {
         REQUIRE_FALSE(puzzle.grid().is_complete());
@@ -80,3 +85,285 @@ TEST_CASE("Solver validates constraints", "[solver]") {
         REQUIRE_FALSE(puzzle.is_valid());
     }
 }
+
+TEST_CASE("Propagation finds dead ends", "[solver]") {
+    Puzzle puzzle(6);
+    
+    SECTION("Empty board") {
+        REQUIRE_FALSE(Solver(puzzle).propagate_to_contradiction());
+    }
+    
+    SECTION("Cell with no legal value") {
+        // (0, 2) would complete three Suns or three Moons
+        puzzle.grid().set(0, 0, Cell::Sun);
+        puzzle.grid().set(0, 1, Cell::Sun);
+        puzzle.grid().set(0, 3, Cell::Moon);
+        puzzle.grid().set(0, 4, Cell::Moon);
+        REQUIRE(puzzle.is_valid());
+        REQUIRE(Solver(puzzle).propagate_to_contradiction());
+    }
+    
+    SECTION("Broken rule") {
+        puzzle.grid().set(2, 0, Cell::Moon);
+        puzzle.grid().set(3, 0, Cell::Moon);
+        puzzle.grid().set(4, 0, Cell::Moon);
+        REQUIRE(Solver(puzzle).propagate_to_contradiction());
+    }
+}
+
+TEST_CASE("Solver search is iterative", "[solver]") {
+    SECTION("Counting leaves the grid untouched") {
+        Puzzle puzzle(6);
+        puzzle.grid().set(0, 0, Cell::Sun);
+        puzzle.grid().set(2, 3, Cell::Moon);
+        
+        Solver solver(puzzle);
+        REQUIRE(solver.count_solutions(5) == 5);
+        
+        REQUIRE(puzzle.grid().get(0, 0) == Cell::Sun);
+        REQUIRE(puzzle.grid().get(2, 3) == Cell::Moon);
+        REQUIRE(puzzle.grid().get_empty_cells().size() == 34);
+    }
+    
+    SECTION("Solves boards larger than 8x8") {
+        Puzzle puzzle(12);
+        
+        Solver solver(puzzle);
+        REQUIRE(solver.solve());
+        REQUIRE(puzzle.grid().is_complete());
+        REQUIRE(puzzle.is_valid());
+        REQUIRE(solver.nodes_visited() > 0);
+    }
+}
+
+TEST_CASE("Solver enumerates solutions lazily", "[solver]") {
+    Puzzle puzzle(6);
+    puzzle.grid().set(0, 0, Cell::Sun);
+    puzzle.grid().set(3, 4, Cell::Moon);
+    
+    SECTION("Enumeration matches counting") {
+        // Regions cut the board down to a few dozen solutions, so the whole
+        // set can be enumerated
+        puzzle.mutable_regions().generate_random_regions(6, 9);
+        uint64_t expected = ModelCounter(puzzle).count();
+        REQUIRE(expected == 70);
+        REQUIRE(Solver(puzzle).count_solutions(1000) == 70);
+        
+        Solver solver(puzzle);
+        std::set<std::vector<uint32_t>> seen;
+        for (const Grid& solution : solver.solutions()) {
+            REQUIRE(solution.is_complete());
+            REQUIRE(solution.get(0, 0) == Cell::Sun);
+            REQUIRE(solution.get(3, 4) == Cell::Moon);
+            
+            std::vector<uint32_t> suns;
+            for (int r = 0; r < 6; ++r) suns.push_back(solution.row_bits(r, Cell::Sun));
+            REQUIRE(seen.insert(suns).second);
+        }
+        REQUIRE(seen.size() == expected);
+        REQUIRE(puzzle.grid().get_empty_cells().size() == 34);
+    }
+    
+    SECTION("Stopping early restores the grid") {
+        Solver solver(puzzle);
+        {
+            auto solutions = solver.solutions();
+            auto it = solutions.begin();
+            REQUIRE(it != solutions.end());
+            ++it;
+            REQUIRE(it != solutions.end());
+            REQUIRE(puzzle.is_valid());
+        }
+        REQUIRE(puzzle.grid().get_empty_cells().size() == 34);
+    }
+}
+
+TEST_CASE("Model counter counts solutions exactly", "[solver][counter]") {
+    SECTION("Empty boards") {
+        Puzzle small(4);
+        REQUIRE(ModelCounter(small).count() == 90);
+        
+        Puzzle medium(6);
+        REQUIRE(ModelCounter(medium).count() == 11222);
+    }
+    
+    SECTION("Agrees with enumeration on a constrained board") {
+        Puzzle puzzle(6);
+        puzzle.mutable_regions().generate_random_regions(6, 2024);
+        puzzle.grid().set(0, 0, Cell::Sun);
+        puzzle.grid().set(4, 2, Cell::Moon);
+        puzzle.add_clue({{1, 1}, {1, 2}, RelationshipClue::Equal});
+        puzzle.add_clue({{2, 4}, {3, 4}, RelationshipClue::NotEqual});
+        
+        ModelCounter counter(puzzle);
+        uint64_t counted = counter.count();
+        REQUIRE_FALSE(counter.saturated());
+        
+        Solver solver(puzzle);
+        REQUIRE(counted == static_cast<uint64_t>(solver.count_solutions(100000)));
+    }
+    
+    SECTION("Generated region layouts are satisfiable") {
+        for (unsigned seed = 1; seed <= 5; ++seed) {
+            Puzzle puzzle(6);
+            puzzle.mutable_regions().generate_random_regions(6, seed);
+            REQUIRE(ModelCounter(puzzle).count() > 0);
+        }
+    }
+}
+
+TEST_CASE("Size-specialised solver agrees with the generic solver", "[solver]") {
+    for (int size : {6, 8}) {
+        Puzzle puzzle(size);
+        puzzle.mutable_regions().generate_random_regions(size, 4242);
+        puzzle.add_clue({{1, 1}, {1, 2}, RelationshipClue::NotEqual});
+        puzzle.add_clue({{2, 0}, {3, 0}, RelationshipClue::Equal});
+        puzzle.grid().set(0, 0, Cell::Sun);
+        puzzle.grid().set(size - 1, size - 1, Cell::Moon);
+        
+        Puzzle copy = puzzle;
+        int expected = Solver(copy).count_solutions(500);
+        
+        auto count = solution_counter_for_size(size);
+        REQUIRE(count(puzzle, 500) == expected);
+        REQUIRE(count(puzzle, 1) == (expected > 0 ? 1 : 0));
+    }
+}
+
+TEST_CASE("Forced moves stay in step with the board", "[solver]") {
+    Puzzle puzzle(8);
+    puzzle.mutable_regions().generate_random_regions(8, 31);
+    puzzle.add_clue({{0, 0}, {0, 1}, RelationshipClue::Equal});
+    puzzle.add_clue({{3, 3}, {4, 3}, RelationshipClue::NotEqual});
+    puzzle.add_clue({{6, 5}, {6, 6}, RelationshipClue::NotEqual});
+    
+    ForcedMoves forced(puzzle);
+    
+    uint32_t state = 777;
+    for (int step = 0; step < 300; ++step) {
+        state = state * 1664525u + 1013904223u;
+        int r = (state >> 8) % 8;
+        int c = (state >> 16) % 8;
+        puzzle.set(r, c, static_cast<Cell>((state >> 24) % 3));
+        forced.update(puzzle, r, c);
+        
+        // Reference: a full rescan
+        Solver solver(puzzle);
+        auto expected = solver.get_forced_moves();
+        REQUIRE(forced.count() == static_cast<int>(expected.size()));
+        for (const auto& move : expected) {
+            REQUIRE(forced.value_at(move.position.row, move.position.col) == move.value);
+        }
+        if (!expected.empty()) {
+            REQUIRE(forced.first() == expected.front().position);
+        } else {
+            REQUIRE_FALSE(forced.first().has_value());
+        }
+    }
+}
+
+TEST_CASE("Fixed-size candidates match the standard rules", "[solver]") {
+    Puzzle puzzle(8);
+    puzzle.mutable_regions().generate_random_regions(8, 57);
+    puzzle.add_clue({{0, 0}, {0, 1}, RelationshipClue::Equal});
+    puzzle.add_clue({{2, 5}, {3, 5}, RelationshipClue::NotEqual});
+    puzzle.add_clue({{5, 2}, {5, 3}, RelationshipClue::NotEqual});
+    puzzle.add_clue({{6, 6}, {7, 6}, RelationshipClue::Equal});
+    
+    // Fill legal values one at a time and compare at every step
+    uint32_t state = 4242;
+    for (int step = 0; step < 40; ++step) {
+        CandidateMasks masks;
+        puzzle.compute_candidates(masks);
+        
+        std::array<uint8_t, 8> sun{};
+        std::array<uint8_t, 8> moon{};
+        BasicPuzzle<8>(puzzle).candidates(sun, moon);
+        for (int r = 0; r < 8; ++r) {
+            REQUIRE(sun[r] == masks.sun[r]);
+            REQUIRE(moon[r] == masks.moon[r]);
+        }
+        
+        std::vector<std::pair<Position, Cell>> open;
+        for (int r = 0; r < 8; ++r) {
+            for (int c = 0; c < 8; ++c) {
+                if ((masks.sun[r] >> c) & 1u) open.push_back({{r, c}, Cell::Sun});
+                if ((masks.moon[r] >> c) & 1u) open.push_back({{r, c}, Cell::Moon});
+            }
+        }
+        if (open.empty()) break;
+        
+        state = state * 1664525u + 1013904223u;
+        auto [pos, value] = open[(state >> 8) % open.size()];
+        puzzle.set(pos.row, pos.col, value);
+    }
+}
+
+TEST_CASE("Fixed-size puzzles reject boards they can't hold", "[solver]") {
+    SECTION("Size must match") {
+        Puzzle puzzle(6);
+        REQUIRE_THROWS_AS(BasicPuzzle<8>(puzzle), std::invalid_argument);
+        REQUIRE_THROWS_AS(BasicSolver<8>(puzzle), std::invalid_argument);
+        REQUIRE_NOTHROW(BasicPuzzle<6>(puzzle));
+    }
+    
+    SECTION("Every region needs an index below kNoRegion") {
+        // One region per cell: 256 on a 16x16 board, one too many
+        Puzzle puzzle(16);
+        for (int i = 0; i < 256; ++i) {
+            Region region(i, 0);
+            region.cells = {{i / 16, i % 16}};
+            puzzle.mutable_regions().add_region(region);
+        }
+        REQUIRE_THROWS_AS(BasicPuzzle<16>(puzzle), std::invalid_argument);
+        
+        Puzzle fits(16);
+        for (int i = 0; i < 255; ++i) {
+            Region region(i, 0);
+            region.cells = {{i / 16, i % 16}};
+            fits.mutable_regions().add_region(region);
+        }
+        REQUIRE_NOTHROW(BasicPuzzle<16>(fits));
+    }
+}
+
+TEST_CASE("Solvers allocate from their puzzle's resource", "[solver]") {
+    // Counts what the puzzle and its solver take from the arena
+    struct Counting : std::pmr::memory_resource {
+        std::pmr::monotonic_buffer_resource arena;
+        size_t allocations = 0;
+        
+        void* do_allocate(size_t bytes, size_t align) override {
+            ++allocations;
+            return arena.allocate(bytes, align);
+        }
+        void do_deallocate(void*, size_t, size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    } counting;
+    
+    Puzzle puzzle(8, &counting);
+    puzzle.mutable_regions().generate_random_regions(8, 31);
+    puzzle.add_clue({{0, 0}, {0, 1}, RelationshipClue::Equal});
+    
+    // Nothing may come from the default resource meanwhile
+    std::pmr::memory_resource* previous = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+    size_t before = counting.allocations;
+    size_t constructed = before;
+    bool solved = false;
+    bool threw = false;
+    try {
+        Solver solver(puzzle);
+        constructed = counting.allocations;
+        solved = solver.solve();
+    } catch (const std::bad_alloc&) {
+        threw = true;
+    }
+    std::pmr::set_default_resource(previous);
+    
+    REQUIRE_FALSE(threw);
+    REQUIRE(constructed > before);  // The search stack
+    REQUIRE(solved);
+    REQUIRE(puzzle.is_solved());
+}